@@ -0,0 +1,19 @@
+//
+//  AppSources.cpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+// The parts of the app the benchmark exercises, compiled straight from ../../src so the numbers
+// are for exactly the code the installation runs. Everything else in there needs a kinect / OpenCV.
+
+#include "../../src/Particle.cpp"
+#include "../../src/ParticleSystem.cpp"
+#include "../../src/Attractor.cpp"
+#include "../../src/ParameterSmoother.cpp"
+#include "../../src/FlowGrid.cpp"
+#include "../../src/ArcLengthSampler.cpp"
+#include "../../src/DepthSegmenter.cpp"
+#include "../../src/InputRecording.cpp"
+#include "../../src/HardwareCounters.cpp"
@@ -0,0 +1,364 @@
+//
+//  DeterminismHarness.cpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "DeterminismHarness.hpp"
+
+static const char * fieldNames[DeterminismHarness::numFields] = {
+    "position.x", "position.y", "velocity.x", "velocity.y", "acceleration.x", "acceleration.y",
+    "flowX", "flowY", "smoothedFlow.x", "smoothedFlow.y", "angle"
+};
+
+//--------------------------------------------------------------
+
+DeterminismHarness::DeterminismHarness(){
+    
+    syntheticFrames = 1200;
+    every = 30;
+    particles = 2000;
+    threads = 1;
+    seed = 1;
+    tolerance = 0;
+    screenWidth = 1920;
+    screenHeight = 1080;
+    stateEvery = 10;
+    updateGolden = false;
+}
+
+//--------------------------------------------------------------
+
+const char * DeterminismHarness::getFieldName(int field){
+    return fieldNames[field];
+}
+
+//--------------------------------------------------------------
+
+int DeterminismHarness::run(const vector<string> & args){
+    
+    for(int i = 0; i < args.size(); i++){
+        bool hasValue = i + 1 < args.size();
+        if(args[i] == "--stream" && hasValue) streamPath = args[++i];
+        else if(args[i] == "--frames" && hasValue) syntheticFrames = ofToInt(args[++i]);
+        else if(args[i] == "--every" && hasValue) every = max(1, ofToInt(args[++i]));
+        else if(args[i] == "--particles" && hasValue) particles = ofToInt(args[++i]);
+        else if(args[i] == "--threads" && hasValue) threads = max(1, ofToInt(args[++i]));
+        else if(args[i] == "--seed" && hasValue) seed = ofToInt(args[++i]);
+        else if(args[i] == "--tolerance" && hasValue) tolerance = ofToFloat(args[++i]);
+        else if(args[i] == "--state-every" && hasValue) stateEvery = max(1, ofToInt(args[++i]));
+        else if(args[i] == "--update-golden") updateGolden = true;
+        else if(args[i] == "--determinism") continue;
+        else ofLogWarning("DeterminismHarness") << "unknown argument " << args[i];
+    }
+    
+    // the golden file says how it was made, so a plain run always reproduces it
+    name = streamPath.empty() ? "synthetic" : ofFilePath::getBaseName(streamPath);
+    vector<DeterminismCheckpoint> golden;
+    if(!updateGolden && !loadGolden(golden)){
+        ofLogError("DeterminismHarness") << "no golden hashes for " << name << ", run with --update-golden and check in bin/data/golden/";
+        return 1;
+    }
+    
+    if(streamPath.empty()){
+        makeSynthetic();
+    } else if(!player.load(streamPath)){
+        ofLogError("DeterminismHarness") << "couldn't load an input stream from " << streamPath;
+        return 1;
+    }
+    
+    ofLogNotice("DeterminismHarness") << "replaying " << player.size() << " frames of " << name << ", " << particles << " particles, "
+    << threads << " threads, seed " << seed << ", hashing every " << every << " frames";
+    
+    vector<DeterminismCheckpoint> results;
+    simulate(results);
+    
+    if(updateGolden){
+        if(!saveGolden(results)) return 1;
+        ofLogNotice("DeterminismHarness") << "saved " << results.size() << " golden hashes to bin/data/golden/" << name << ".txt";
+        return 0;
+    }
+    return compare(golden, results) > 0 ? 1 : 0;
+}
+
+//--------------------------------------------------------------
+
+void DeterminismHarness::makeSynthetic(){
+    
+    // the same swaying ellipse and patch of flow as ParticleBench, plus the things a session does:
+    // the mode moving on every 300 frames and a second body walking in for a while
+    player.clear();
+    ofRectangle screen(0, 0, screenWidth, screenHeight);
+    
+    for(int frame = 0; frame < syntheticFrames; frame++){
+        float t = frame / 60.0;
+        InputFrame f;
+        f.mode = 1 + (frame / 300) % 4;
+        f.flowX = 4 * sin(t * 3);
+        f.flowY = cos(t * 2);
+        
+        int numBodies = (frame / 150) % 4 == 3 ? 2 : 1;
+        f.bodies.resize(numBodies);
+        for(int b = 0; b < numBodies; b++){
+            ofPoint centre(screen.width * (b + 1) / (numBodies + 1) + 200 * sin(t + b), screen.height / 2);
+            for(int i = 0; i < 120; i++){
+                float a = TWO_PI * i / 120;
+                float wobble = 1 + 0.1 * sin(a * 5 + t * 4);
+                f.bodies[b].addVertex(centre.x + cos(a) * 140 * wobble, centre.y + sin(a) * 320 * wobble);
+            }
+            f.bodies[b].close();
+        }
+        
+        ofPoint centre = f.bodies[0].getCentroid2D();
+        f.flowField.setScreenRect(screen);
+        for(int y = 0; y < FlowGrid::rows; y++){
+            for(int x = 0; x < FlowGrid::cols; x++){
+                float cx = (x + 0.5) * screen.width / FlowGrid::cols;
+                float cy = (y + 0.5) * screen.height / FlowGrid::rows;
+                float falloff = exp(-ofDistSquared(cx, cy, centre.x, centre.y) / (300.0 * 300.0));
+                f.flowField.data[(y * FlowGrid::cols + x) * 2] = f.flowX * falloff;
+                f.flowField.data[(y * FlowGrid::cols + x) * 2 + 1] = f.flowY * falloff;
+            }
+        }
+        player.add(f);
+    }
+}
+
+//--------------------------------------------------------------
+
+void DeterminismHarness::simulate(vector<DeterminismCheckpoint> & checkpoints){
+    
+    // ofGetFrameNum (mode 4's gravity, the shape rotation) stays at 0 while the bench runs in setup
+    ParticleSystem system;
+    system.setup(particles);
+    system.numThreads = threads;
+    system.screenWidth = screenWidth;
+    system.screenHeight = screenHeight;
+    scatter(system);
+    
+    checkpoints.clear();
+    for(int frame = 0; frame < player.size(); frame++){
+        player.apply(frame, system);
+        system.update();
+        
+        if((frame + 1) % every == 0){
+            checkpoints.push_back(DeterminismCheckpoint());
+            snapshot(system, frame + 1, checkpoints.back());
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+// the Particle constructor draws its start from ofRandom over the window, and rand() differs
+// between platforms. everything it randomises that the simulation reads is dealt again here, from
+// a generator the standard pins down, over the fixed screen.
+void DeterminismHarness::scatter(ParticleSystem & system){
+    
+    std::mt19937 random(seed);
+    auto uniform = [&](float low, float high){
+        return low + (high - low) * ((random() >> 8) * (1.0f / 16777216));
+    };
+    
+    for(int i = 0; i < system.particles.size(); i++){
+        Particle & p = system.particles[i];
+        p.position.set(uniform(0, screenWidth), uniform(0, screenHeight), 0);
+        p.mass = uniform(0.2, 4);
+        p.angle = uniform(0, TWO_PI);
+        p.randomFlowOffset = uniform(1, 3);
+        p.randomOffset = uniform(0.05, 0.3);
+        p.randomLerpOffset = uniform(0, 1);
+        
+        // the constructor sizes the smoother from ofGetFrameRate, which isn't settled during setup
+        *p.smoothedFlow.smoother = ParameterSmoother(5., 60);
+    }
+}
+
+//--------------------------------------------------------------
+
+void DeterminismHarness::snapshot(const ParticleSystem & system, int frame, DeterminismCheckpoint & out){
+    
+    out.frame = frame;
+    out.state.resize(system.particles.size() * numFields);
+    
+    float * f = out.state.data();
+    for(int i = 0; i < system.particles.size(); i++){
+        const Particle & p = system.particles[i];
+        *f++ = p.position.x;
+        *f++ = p.position.y;
+        *f++ = p.velocity.x;
+        *f++ = p.velocity.y;
+        *f++ = p.acceleration.x;
+        *f++ = p.acceleration.y;
+        *f++ = p.flowX;
+        *f++ = p.flowY;
+        *f++ = p.smoothedFlow.currentValue.x;
+        *f++ = p.smoothedFlow.currentValue.y;
+        *f++ = p.angle;
+    }
+    
+    // FNV-1a over the raw bits, so exact mode really is bit for bit
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char * bytes = (const unsigned char *) out.state.data();
+    for(size_t i = 0; i < out.state.size() * sizeof(float); i++){
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    out.hash = hash;
+}
+
+//--------------------------------------------------------------
+
+int DeterminismHarness::compare(const vector<DeterminismCheckpoint> & golden, const vector<DeterminismCheckpoint> & results){
+    
+    if(golden.size() != results.size()){
+        ofLogWarning("DeterminismHarness") << "golden has " << golden.size() << " checkpoints, this run made " << results.size();
+    }
+    
+    // everything after the first divergence diverges too, so stop there
+    int checked = min(golden.size(), results.size());
+    int compared = checked;
+    for(int i = 0; i < checked; i++){
+        const DeterminismCheckpoint & g = golden[i];
+        const DeterminismCheckpoint & r = results[i];
+        
+        if(tolerance <= 0){
+            if(g.hash == r.hash) continue;
+            ofLogError("DeterminismHarness") << "DIVERGED at frame " << r.frame << ": hash " << ofToHex(r.hash) << ", golden " << ofToHex(g.hash);
+            if(!findDivergence(g, r, 0)){
+                ofLogError("DeterminismHarness") << "no golden state to compare against, only the hash";
+            }
+            return 1;
+        }
+        
+        // only the checkpoints with a stored state can be compared within a tolerance
+        if(g.state.empty()){
+            compared--;
+            continue;
+        }
+        if(findDivergence(g, r, tolerance)){
+            ofLogError("DeterminismHarness") << "DIVERGED at frame " << r.frame << " beyond a tolerance of " << tolerance;
+            return 1;
+        }
+    }
+    
+    if(compared == 0){
+        ofLogError("DeterminismHarness") << "no golden state to compare within a tolerance";
+        return 1;
+    }
+    ofLogNotice("DeterminismHarness") << "matched " << compared << " checkpoints " << (tolerance > 0 ? "within " + ofToString(tolerance) : "exactly");
+    return golden.size() == results.size() ? 0 : 1;
+}
+
+//--------------------------------------------------------------
+
+bool DeterminismHarness::findDivergence(const DeterminismCheckpoint & golden, const DeterminismCheckpoint & result, float epsilon){
+    
+    if(golden.state.size() != result.state.size()){
+        ofLogError("DeterminismHarness") << "golden state has " << golden.state.size() / numFields << " particles, this run "
+        << result.state.size() / numFields;
+        return !golden.state.empty();
+    }
+    
+    for(int i = 0; i < result.state.size(); i++){
+        float g = golden.state[i];
+        float r = result.state[i];
+        
+        // exact compares the bits (NaN == NaN, 0 != -0), tolerance is relative above 1 and absolute below
+        bool same = epsilon > 0 ? fabs(r - g) <= epsilon * max(1.f, fabs(g)) : memcmp(&g, &r, sizeof(float)) == 0;
+        if(same) continue;
+        
+        ofLogError("DeterminismHarness") << "first divergence: particle " << i / numFields << " " << getFieldName(i % numFields)
+        << " = " << ofToString(r, 9) << ", golden " << ofToString(g, 9) << " (diff " << r - g << ")";
+        return true;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+
+bool DeterminismHarness::saveGolden(const vector<DeterminismCheckpoint> & checkpoints){
+    
+    ofDirectory::createDirectory("golden", true, true);
+    ofstream text(ofToDataPath("golden/" + name + ".txt").c_str());
+    FILE * state = fopen(ofToDataPath("golden/" + name + ".state").c_str(), "wb");
+    if(!text.is_open() || !state){
+        ofLogError("DeterminismHarness") << "couldn't write bin/data/golden/" << name;
+        if(state) fclose(state);
+        return false;
+    }
+    
+    // the hashes are what gets compared, the state is only read back to say where a run went wrong
+    // (and for --tolerance). it's big, so only the first and every stateEvery'th checkpoint keep it.
+    text << "# determinism golden for " << name << ", regenerate with bin/bench --determinism --update-golden" << endl
+         << "particles " << particles << endl
+         << "seed " << seed << endl
+         << "every " << every << endl
+         << "frames " << player.size() << endl
+         << "screen " << screenWidth << " " << screenHeight << endl;
+    
+    for(int i = 0; i < checkpoints.size(); i++){
+        const DeterminismCheckpoint & c = checkpoints[i];
+        text << "hash " << c.frame << " " << ofToHex(c.hash) << endl;
+        
+        if(i % stateEvery != 0) continue;
+        int count = c.state.size();
+        fwrite(&c.frame, sizeof(int), 1, state);
+        fwrite(&count, sizeof(int), 1, state);
+        fwrite(c.state.data(), sizeof(float), count, state);
+    }
+    fclose(state);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+bool DeterminismHarness::loadGolden(vector<DeterminismCheckpoint> & checkpoints){
+    
+    ifstream text(ofToDataPath("golden/" + name + ".txt").c_str());
+    if(!text.is_open()) return false;
+    
+    checkpoints.clear();
+    string line;
+    int frames = 0;
+    while(getline(text, line)){
+        vector<string> words = ofSplitString(line, " ", true, true);
+        if(words.empty() || words[0][0] == '#') continue;
+        
+        if(words[0] == "particles" && words.size() > 1) particles = ofToInt(words[1]);
+        else if(words[0] == "seed" && words.size() > 1) seed = ofToInt(words[1]);
+        else if(words[0] == "every" && words.size() > 1) every = ofToInt(words[1]);
+        else if(words[0] == "frames" && words.size() > 1) frames = ofToInt(words[1]);
+        else if(words[0] == "screen" && words.size() > 2){
+            screenWidth = ofToFloat(words[1]);
+            screenHeight = ofToFloat(words[2]);
+        }
+        else if(words[0] == "hash" && words.size() > 2){
+            DeterminismCheckpoint c;
+            c.frame = ofToInt(words[1]);
+            c.hash = strtoull(words[2].c_str(), NULL, 16);
+            checkpoints.push_back(c);
+        }
+    }
+    
+    // a synthetic stream is as long as the golden one was
+    if(frames > 0) syntheticFrames = frames;
+    
+    // optional, and only some checkpoints have one: without it a failure can only name the frame
+    FILE * state = fopen(ofToDataPath("golden/" + name + ".state").c_str(), "rb");
+    if(state){
+        int i = 0;
+        int frame, count;
+        while(fread(&frame, sizeof(int), 1, state) == 1 && fread(&count, sizeof(int), 1, state) == 1 && count >= 0){
+            while(i < checkpoints.size() && checkpoints[i].frame < frame) i++;
+            if(i == checkpoints.size() || checkpoints[i].frame != frame) break;
+            checkpoints[i].state.resize(count);
+            if(fread(checkpoints[i].state.data(), sizeof(float), count, state) != count){
+                checkpoints[i].state.clear();
+                break;
+            }
+        }
+        fclose(state);
+    }
+    return !checkpoints.empty();
+}
@@ -0,0 +1,74 @@
+//
+//  DeterminismHarness.hpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+// Replays a recorded input stream (InputRecorder, I in the app) or a synthetic one through
+// ParticleSystem with a fixed seed, hashes every particle's state every K frames and compares the
+// hashes against the ones checked in under bin/data/golden/. Exact mode wants bit identical floats;
+// tolerance mode (for SIMD / threaded paths that reorder arithmetic) compares the stored state
+// snapshots within an epsilon instead. Either way the first diverging particle and field is printed.
+// The simulation runs on a fixed screen, not the window, and the harness deals the particles'
+// random starting state itself, so a golden doesn't depend on the window size or on rand().
+
+#pragma once
+
+#ifndef DeterminismHarness_hpp
+#define DeterminismHarness_hpp
+
+#include <stdio.h>
+#include <random>
+#include "ofMain.h"
+#include "ParticleSystem.hpp"
+#include "InputRecording.hpp"
+
+#endif /* DeterminismHarness_hpp */
+
+
+struct DeterminismCheckpoint{
+    int frame;
+    uint64_t hash;
+    vector<float> state;            // numFields floats per particle
+};
+
+
+class DeterminismHarness{
+    
+public:
+    DeterminismHarness();
+    
+    // returns non zero when the run doesn't match the golden hashes
+    int run(const vector<string> & args);
+    
+    string streamPath;              // empty = the synthetic stream
+    int syntheticFrames;
+    int every;                      // hash every K frames
+    int particles;
+    int threads;
+    unsigned int seed;
+    float tolerance;                // 0 = exact hashes
+    float screenWidth, screenHeight;    // the screen the particles start on and wrap around
+    int stateEvery;                 // keep the full state of every Nth checkpoint in the golden
+    bool updateGolden;
+    
+    static const int numFields = 11;
+    static const char * getFieldName(int field);
+    
+private:
+    void makeSynthetic();
+    void simulate(vector<DeterminismCheckpoint> & checkpoints);
+    void scatter(ParticleSystem & system);
+    void snapshot(const ParticleSystem & system, int frame, DeterminismCheckpoint & out);
+    
+    int compare(const vector<DeterminismCheckpoint> & golden, const vector<DeterminismCheckpoint> & results);
+    bool findDivergence(const DeterminismCheckpoint & golden, const DeterminismCheckpoint & result, float epsilon);
+    
+    bool saveGolden(const vector<DeterminismCheckpoint> & checkpoints);
+    bool loadGolden(vector<DeterminismCheckpoint> & checkpoints);
+    
+    InputPlayer player;
+    string name;
+    
+};
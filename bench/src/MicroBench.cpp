@@ -0,0 +1,412 @@
+//
+//  MicroBench.cpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "MicroBench.hpp"
+
+//--------------------------------------------------------------
+
+MicroBench::MicroBench(){
+    
+    numParticles = 10000;
+    warmupCalls = 20;
+    samples = 31;
+    sampleMillis = 2;
+    sink = 0;
+}
+
+//--------------------------------------------------------------
+
+int MicroBench::run(const vector<string> & args){
+    
+    for(int i = 0; i < args.size(); i++){
+        bool hasValue = i + 1 < args.size();
+        if(args[i] == "--particles" && hasValue) numParticles = ofToInt(args[++i]);
+        else if(args[i] == "--samples" && hasValue) samples = ofToInt(args[++i]);
+        else if(args[i] == "--filter" && hasValue) filter = args[++i];
+    }
+    
+    // same particles, outlines and depth every run
+    ofSeedRandom(1234);
+    
+    if(checkGroupTargets() > 0) return 1;
+    
+    benchAttract();
+    benchPointAtPercent();
+    benchSmoother();
+    benchParticleUpdate();
+    benchCheckEdges();
+    benchDepthThreshold();
+    benchFlowReduction();
+    
+    string path = "micro-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json";
+    writeJson(path);
+    ofLogNotice("MicroBench") << "results in bin/data/" << path;
+    return 0;
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::measure(const string & name, const string & variant, int opsPerCall, std::function<void()> call){
+    
+    if(!filter.empty() && name.find(filter) == string::npos) return;
+    
+    for(int i = 0; i < warmupCalls; i++) call();
+    
+    // enough calls per sample to be well above the timer's resolution
+    uint64_t start = ofGetElapsedTimeMicros();
+    call();
+    double callMicros = max<double>(1, ofGetElapsedTimeMicros() - start);
+    int repeats = max(1, int(sampleMillis * 1000 / callMicros));
+    
+    vector<double> ns(samples);
+    for(int s = 0; s < samples; s++){
+        start = ofGetElapsedTimeMicros();
+        for(int r = 0; r < repeats; r++) call();
+        ns[s] = (ofGetElapsedTimeMicros() - start) * 1000.0 / ((double) repeats * opsPerCall);
+    }
+    
+    std::sort(ns.begin(), ns.end());
+    MicroResult result;
+    result.name = name;
+    result.variant = variant;
+    result.samples = samples;
+    result.repeats = repeats;
+    result.minNs = ns[0];
+    result.medianNs = ns[samples / 2];
+    result.p95Ns = ns[(samples - 1) * 95 / 100];
+    double sum = 0, sumSq = 0;
+    for(int s = 0; s < samples; s++){
+        sum += ns[s];
+        sumSq += ns[s] * ns[s];
+    }
+    result.meanNs = sum / samples;
+    result.stddevNs = sqrt(max(0.0, sumSq / samples - result.meanNs * result.meanNs));
+    results.push_back(result);
+    
+    char line[160];
+    snprintf(line, sizeof(line), "%-22s %-10s median %9.2f ns  min %9.2f  p95 %9.2f  sd %7.2f", name.c_str(), variant.c_str(),
+             result.medianNs, result.minNs, result.p95Ns, result.stddevNs);
+    ofLogNotice("MicroBench") << line;
+}
+
+//--------------------------------------------------------------
+
+// the original signature, kept here as the reference: the particle (and its shape points) is copied
+static ofPoint attractByValue(Attractor a, Particle p){
+    
+    ofPoint force = a.position - p.position;
+    float d = ofDist(p.position.x, p.position.y, a.position.x, a.position.y);
+    d = 25.;    // what Attractor's d = (d, 2., 25.) works out to
+    force.normalize();
+    float strength = (a.G * a.mass * p.mass) / (d * d);
+    force *= strength;
+    return force;
+}
+
+void MicroBench::benchAttract(){
+    
+    vector<Particle> particles(numParticles);
+    Attractor a(ofPoint(500, 400), 10);
+    
+    measure("attract", "scalar", numParticles, [&](){
+        ofPoint sum;
+        for(int i = 0; i < particles.size(); i++) sum += attractByValue(a, particles[i]);
+        sink = sum.x;
+    });
+    measure("attract", "optimised", numParticles, [&](){
+        ofPoint sum;
+        for(int i = 0; i < particles.size(); i++) sum += a.attract(particles[i]);
+        sink = sum.x;
+    });
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchPointAtPercent(){
+    
+    // a 120 vertex closed outline, the size of the physics outline
+    ofPolyline body;
+    for(int i = 0; i < 120; i++){
+        float a = TWO_PI * i / 120;
+        body.addVertex(960 + cos(a) * 140 * (1 + 0.1 * sin(a * 5)), 540 + sin(a) * 320);
+    }
+    body.close();
+    body.getPerimeter();
+    
+    vector<float> percents(numParticles);
+    for(int i = 0; i < numParticles; i++) percents[i] = float(i) / numParticles;
+    vector<ofPoint> out(numParticles);
+    ArcLengthSampler sampler;
+    
+    measure("pointAtPercent", "scalar", numParticles, [&](){
+        for(int i = 0; i < numParticles; i++) out[i] = body.getPointAtPercent(percents[i]);
+        sink = out[numParticles / 2].x;
+    });
+    measure("pointAtPercent", "optimised", numParticles, [&](){
+        sampler.sample(body, percents.data(), numParticles, out.data());
+        sink = out[numParticles / 2].x;
+    });
+}
+
+//--------------------------------------------------------------
+
+// every particle's sampled target has to be the point getPointAtPercent gives for its group and
+// percent, with particle counts that don't split evenly over the bodies
+int MicroBench::checkGroupTargets(){
+    
+    int mismatches = 0;
+    int counts[] = { 100, 1000, 1001 };
+    for(int c = 0; c < 3; c++){
+        for(int numBodies = 2; numBodies <= 4; numBodies++){
+            ParticleSystem system;
+            system.setup(counts[c]);
+            system.setNumBodies(numBodies);
+            for(int g = 0; g < numBodies; g++){
+                ofPolyline outline;
+                int vertices = 60 + g * 37;
+                for(int i = 0; i < vertices; i++){
+                    float a = TWO_PI * i / vertices;
+                    outline.addVertex(300 + g * 400 + cos(a) * 120 * (1 + 0.2 * sin(a * (g + 3))), 540 + sin(a) * 300);
+                }
+                if(g % 2 == 0) outline.close();
+                system.receiveBody(g, outline);
+            }
+            system.update();
+            
+            for(int x = 0; x < counts[c]; x++){
+                ofPoint expected = system.bodies[system.particleGroup[x]].getPointAtPercent(system.particlePercent[x]);
+                if(expected.distance(system.particleTargets[x]) < 0.01) continue;
+                if(mismatches++ == 0){
+                    ofLogError("MicroBench") << counts[c] << " particles, " << numBodies << " bodies: particle " << x
+                        << " (group " << system.particleGroup[x] << ", percent " << system.particlePercent[x] << ") targets "
+                        << system.particleTargets[x] << " instead of " << expected;
+                }
+            }
+        }
+    }
+    if(mismatches > 0) ofLogError("MicroBench") << mismatches << " particle targets differ from getPointAtPercent";
+    else ofLogNotice("MicroBench") << "particle targets match getPointAtPercent for 2, 3 and 4 bodies";
+    return mismatches;
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchSmoother(){
+    
+    // scalar: one heap allocated smoother per particle, as Particle has them
+    vector<ParameterSmoother *> smoothers(numParticles);
+    for(int i = 0; i < numParticles; i++) smoothers[i] = new ParameterSmoother(5., 60);
+    vector<ofPoint> targets(numParticles, ofPoint(1, -1));
+    vector<ofPoint> out(numParticles);
+    
+    measure("smoother", "scalar", numParticles, [&](){
+        for(int i = 0; i < numParticles; i++) out[i] = smoothers[i]->process(targets[i]);
+        sink = out[0].x;
+    });
+    
+    // candidate: every particle smooths with the same time constant, so the state can live in
+    // flat arrays and the loop vectorises
+    float a = exp(- TWO_PI / 5. * 0.001 * 60);
+    float b = 1 - a;
+    vector<float> z1(numParticles, 0), z2(numParticles, 0), tx(numParticles, 1), ty(numParticles, -1);
+    
+    measure("smoother", "optimised", numParticles, [&](){
+        float * p1 = z1.data();
+        float * p2 = z2.data();
+        const float * x = tx.data();
+        const float * y = ty.data();
+        for(int i = 0; i < numParticles; i++){
+            p1[i] = x[i] * b + p1[i] * a;
+            p2[i] = y[i] * b + p2[i] * a;
+        }
+        sink = p1[0];
+    });
+    
+    for(int i = 0; i < numParticles; i++) delete smoothers[i];
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchParticleUpdate(){
+    
+    vector<Particle> particles(numParticles);
+    ofPoint force(0.1, 0.2);
+    
+    measure("particle update", "scalar", numParticles, [&](){
+        for(int i = 0; i < numParticles; i++){
+            particles[i].applyForce(force);
+            particles[i].update();
+        }
+        sink = particles[0].position.x;
+    });
+    
+    // candidate: the same force / friction / integrate / limit steps over flat arrays
+    // (the flow smoothing is left out, benchSmoother covers it)
+    vector<float> px(numParticles), py(numParticles), vx(numParticles, 0), vy(numParticles, 0), invMass(numParticles);
+    for(int i = 0; i < numParticles; i++){
+        px[i] = particles[i].position.x;
+        py[i] = particles[i].position.y;
+        invMass[i] = 1 / particles[i].mass;
+    }
+    float maxSpeed = 5;
+    
+    measure("particle update", "optimised", numParticles, [&](){
+        for(int i = 0; i < numParticles; i++){
+            float speed = sqrtf(vx[i] * vx[i] + vy[i] * vy[i]);
+            float frictionScale = speed > 0 ? -0.1f / speed : 0;
+            float ax = (force.x + vx[i] * frictionScale) * invMass[i];
+            float ay = (force.y + vy[i] * frictionScale) * invMass[i];
+            vx[i] += ax;
+            vy[i] += ay;
+            px[i] += vx[i];
+            py[i] += vy[i];
+            float newSpeed = sqrtf(vx[i] * vx[i] + vy[i] * vy[i]);
+            float limit = newSpeed > maxSpeed ? maxSpeed / newSpeed : 1;
+            vx[i] *= limit;
+            vy[i] *= limit;
+        }
+        sink = px[0];
+    });
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchCheckEdges(){
+    
+    vector<Particle> particles(numParticles);
+    for(int i = 0; i < numParticles; i++) particles[i].radius = 10;
+    
+    measure("checkEdges", "scalar", numParticles, [&](){
+        for(int i = 0; i < numParticles; i++) particles[i].checkEdges();
+        sink = particles[0].position.x;
+    });
+    measure("checkEdges", "optimised", numParticles, [&](){
+        float w = ofGetWidth();
+        float h = ofGetHeight();
+        for(int i = 0; i < numParticles; i++) particles[i].checkEdges(w, h);
+        sink = particles[0].position.x;
+    });
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchDepthThreshold(){
+    
+    // a kinect frame: a person at ~1.5m in front of a wall at 3m, some holes with no reading
+    int w = 640, h = 480;
+    ofShortPixels raw;
+    raw.allocate(w, h, 1);
+    ofPixels depth8;
+    depth8.allocate(w, h, 1);
+    for(int y = 0; y < h; y++){
+        for(int x = 0; x < w; x++){
+            bool body = ofDist(x, y, 320, 260) < 150;
+            unsigned short mm = ofRandom(1) < 0.02 ? 0 : (body ? 1500 : 3000) + ofRandom(-30, 30);
+            raw[y * w + x] = mm;
+            depth8[y * w + x] = mm == 0 ? 0 : ofMap(mm, 500, 4000, 255, 0, true);
+        }
+    }
+    
+    // scalar: the original 8 bit path - mirror into the image, then threshold with a branch per pixel
+    ofPixels mirrored;
+    mirrored.allocate(w, h, 1);
+    int nearThreshold = 208, farThreshold = 80;
+    measure("depth threshold", "scalar", w * h, [&](){
+        for(int y = 0; y < h; y++){
+            for(int x = 0; x < w; x++) mirrored[y * w + x] = depth8[y * w + w - 1 - x];
+        }
+        for(int i = 0; i < w * h; i++){
+            if(mirrored[i] < nearThreshold && mirrored[i] > farThreshold) {
+                mirrored[i] = 255;
+            } else {
+                mirrored[i] = 0;
+            }
+        }
+        sink = mirrored[w * h / 2];
+    });
+    
+    // optimised: DepthSegmenter, raw millimetres, mirrored and thresholded in one branchless pass
+    DepthSegmenter segmenter;
+    segmenter.setRange(500, 2500);
+    segmenter.useBackground = false;
+    vector<unsigned char> mask(w * h);
+    measure("depth threshold", "optimised", w * h, [&](){
+        segmenter.segment(raw, mask.data(), w, true);
+        sink = mask[w * h / 2];
+    });
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::benchFlowReduction(){
+    
+    // a decimated flow field (160 x 120) with a moving region in the middle
+    int w = 160, h = 120;
+    vector<float> flowX(w * h), flowY(w * h), flow(w * h * 2);
+    for(int i = 0; i < w * h; i++){
+        bool moving = ofDist(i % w, i / w, 80, 60) < 30;
+        flowX[i] = moving ? ofRandom(2, 5) : ofRandom(-0.2, 0.2);
+        flowY[i] = moving ? ofRandom(-1, 1) : ofRandom(-0.2, 0.2);
+        flow[i * 2] = flowX[i];
+        flow[i * 2 + 1] = flowY[i];
+    }
+    
+    // scalar: the original mean from opticalFlowDraw, a branch per vector (here over the whole field)
+    measure("flow reduction", "scalar", w * h, [&](){
+        float sumX = 0, sumY = 0;
+        int numOfEntries = 0;
+        for(int y = 0; y < h; y++){
+            for(int x = 0; x < w; x++){
+                float fx = flowX[x + w * y];
+                float fy = flowY[x + w * y];
+                if(fabs(fx) + fabs(fy) > 1){
+                    sumX += fx;
+                    sumY += fy;
+                    numOfEntries++;
+                }
+            }
+        }
+        sink = numOfEntries > 0 ? sumX / numOfEntries + sumY / numOfEntries : 0;
+    });
+    
+    // optimised: FlowStage::computeStats' sums, a 0/1 weight per vector and per row accumulators
+    measure("flow reduction", "optimised", w * h, [&](){
+        float sumX = 0, sumY = 0, numMoving = 0;
+        for(int y = 0; y < h; y++){
+            const float * f = flow.data() + y * w * 2;
+            float rowX = 0, rowY = 0, rowMoving = 0;
+            for(int x = 0; x < w; x++){
+                float fx = f[x * 2];
+                float fy = f[x * 2 + 1];
+                float weight = (fabsf(fx) + fabsf(fy) > 1) ? 1 : 0;
+                rowX += fx * weight;
+                rowY += fy * weight;
+                rowMoving += weight;
+            }
+            sumX += rowX;
+            sumY += rowY;
+            numMoving += rowMoving;
+        }
+        sink = numMoving > 0 ? sumX / numMoving + sumY / numMoving : 0;
+    });
+}
+
+//--------------------------------------------------------------
+
+void MicroBench::writeJson(const string & path){
+    
+    ofstream json(ofToDataPath(path).c_str());
+    json << "{\"particles\": " << numParticles << ", \"results\": [\n";
+    for(int i = 0; i < results.size(); i++){
+        const MicroResult & r = results[i];
+        json << "{\"name\": \"" << r.name << "\", \"variant\": \"" << r.variant << "\", \"samples\": " << r.samples
+             << ", \"repeats\": " << r.repeats << ", \"minNs\": " << r.minNs << ", \"medianNs\": " << r.medianNs
+             << ", \"meanNs\": " << r.meanNs << ", \"p95Ns\": " << r.p95Ns << ", \"stddevNs\": " << r.stddevNs
+             << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "]}\n";
+}
@@ -0,0 +1,69 @@
+//
+//  MicroBench.hpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+// Microbenchmarks for the primitives every frame leans on, each with the original (scalar)
+// version next to the optimised one: the optimised versions are either what the app uses now
+// or a candidate, so an optimisation only goes in with numbers behind it.
+// Every case warms up, calibrates a repeat count so one sample takes ~2ms, then takes
+// 'samples' samples and reports min / median / mean / p95 / stddev in ns per operation.
+// Results go to bin/data/micro-<timestamp>.json.
+// Before timing anything it checks that ParticleSystem's sampled targets match getPointAtPercent
+// for 2, 3 and 4 bodies, and exits 1 if they don't.
+
+#pragma once
+
+#ifndef MicroBench_hpp
+#define MicroBench_hpp
+
+#include <stdio.h>
+#include <functional>
+#include "ofMain.h"
+#include "ParticleSystem.hpp"
+#include "DepthSegmenter.hpp"
+
+#endif /* MicroBench_hpp */
+
+
+struct MicroResult{
+    string name;
+    string variant;
+    int samples;
+    int repeats;
+    double minNs, medianNs, meanNs, p95Ns, stddevNs;    // per operation
+};
+
+
+class MicroBench{
+    
+public:
+    MicroBench();
+    
+    int run(const vector<string> & args);
+    
+    int numParticles;       // particles per case
+    int warmupCalls;
+    int samples;
+    double sampleMillis;
+    string filter;          // only cases whose name contains this
+    
+private:
+    void measure(const string & name, const string & variant, int opsPerCall, std::function<void()> call);
+    void writeJson(const string & path);
+    int checkGroupTargets();
+    
+    void benchAttract();
+    void benchPointAtPercent();
+    void benchSmoother();
+    void benchParticleUpdate();
+    void benchCheckEdges();
+    void benchDepthThreshold();
+    void benchFlowReduction();
+    
+    vector<MicroResult> results;
+    volatile float sink;    // results are written here so nothing gets optimised away
+    
+};
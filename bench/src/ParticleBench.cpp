@@ -0,0 +1,321 @@
+//
+//  ParticleBench.cpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "ParticleBench.hpp"
+#include <thread>
+
+//--------------------------------------------------------------
+
+ParticleBench::ParticleBench(){
+    
+    minParticles = 100;
+    maxParticles = 1000000;
+    maxThreads = max(1u, std::thread::hardware_concurrency());
+    secondsPerRun = 0.5;
+    minFrames = 3;
+    warmupFrames = 2;
+    tolerance = 0.1;
+    saveBaseline = false;
+    useCounters = false;
+}
+
+//--------------------------------------------------------------
+
+int ParticleBench::run(const vector<string> & args){
+    
+    for(int i = 0; i < args.size(); i++){
+        bool hasValue = i + 1 < args.size();
+        if(args[i] == "--max-particles" && hasValue) maxParticles = ofToInt(args[++i]);
+        else if(args[i] == "--max-threads" && hasValue) maxThreads = ofToInt(args[++i]);
+        else if(args[i] == "--seconds" && hasValue) secondsPerRun = ofToFloat(args[++i]);
+        else if(args[i] == "--session" && hasValue) sessionDir = args[++i];
+        else if(args[i] == "--stream" && hasValue) streamPath = args[++i];
+        else if(args[i] == "--save-baseline") saveBaseline = true;
+        else if(args[i] == "--counters") useCounters = true;
+        else if(args[i] == "--micro") continue;
+        else ofLogWarning("ParticleBench") << "unknown argument " << args[i];
+    }
+    
+    HardwareCounts probe;
+    if(useCounters && !HardwareCounters::read(probe)){
+        ofLogWarning("ParticleBench") << "no hardware counters (" << HardwareCounters::getStatus() << "), timing only";
+        useCounters = false;
+    }
+    
+    if(!streamPath.empty()){
+        if(stream.load(streamPath)) ofLogNotice("ParticleBench") << "replaying " << stream.size() << " recorded frames from " << streamPath;
+        else ofLogError("ParticleBench") << "couldn't load an input stream from " << streamPath << ", using the synthetic body";
+    }
+    
+    if(!sessionDir.empty() && !loadSession(sessionDir)){
+        ofLogError("ParticleBench") << "couldn't load a session from " << sessionDir << ", using the synthetic body";
+    }
+    
+    vector<ParticleBenchResult> results;
+    for(int particles = minParticles; particles <= maxParticles; particles *= 10){
+        
+        // one system per particle count, reused for every mode and thread count
+        ParticleSystem system;
+        system.setup(particles);
+        
+        for(int mode = 1; mode <= 4; mode++){
+            for(int threads = 1; threads <= maxThreads; threads *= 2){
+                ParticleBenchResult r = runOne(system, mode, threads);
+                results.push_back(r);
+                ofLogNotice("ParticleBench") << "mode " << mode << ", " << particles << " particles, " << threads << " threads: "
+                << ofToString(r.nsPerParticleFrame, 1) << " ns/particle/frame, " << ofToString(r.particlesPerSecond / 1000000, 2) << "M/s"
+                << (r.hasCounters ? ", IPC " + ofToString(r.counters[HW_INSTRUCTIONS] / max(r.counters[HW_CYCLES], 1e-9), 2)
+                    + ", LLC misses/particle " + ofToString(r.counters[HW_LLC_MISSES], 3) : "");
+            }
+        }
+    }
+    
+    string path = "bench-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json";
+    writeJson(path, results);
+    ofLogNotice("ParticleBench") << "results in bin/data/" << path;
+    
+    if(saveBaseline){
+        writeJson("baseline.json", results);
+        ofLogNotice("ParticleBench") << "saved as the new baseline";
+        return 0;
+    }
+    
+    vector<ParticleBenchResult> baseline;
+    if(!loadJson("baseline.json", baseline)){
+        ofLogNotice("ParticleBench") << "no baseline yet, run with --save-baseline to make one";
+        return 0;
+    }
+    return compare(baseline, results) > 0 ? 1 : 0;
+}
+
+//--------------------------------------------------------------
+
+ParticleBenchResult ParticleBench::runOne(ParticleSystem & system, int mode, int threads){
+    
+    // gestures never fire here, so the mode stays where it's put
+    system.modeCounter = mode;
+    system.numThreads = threads;
+    
+    int frame = 0;
+    for(; frame < warmupFrames; frame++){
+        feed(system, frame);
+        system.update();
+    }
+    
+    // only system.update is timed (and counted), making the inputs isn't
+    bool counting = useCounters && threads == 1;
+    double counted[NUM_HW_COUNTERS] = { 0 };
+    HardwareCounts before, after;
+    
+    uint64_t elapsed = 0;
+    int frames = 0;
+    while(frames < minFrames || elapsed < secondsPerRun * 1000000){
+        feed(system, frame++);
+        if(counting) HardwareCounters::read(before);
+        uint64_t start = ofGetElapsedTimeMicros();
+        system.update();
+        elapsed += ofGetElapsedTimeMicros() - start;
+        if(counting && before.valid && HardwareCounters::read(after)){
+            for(int c = 0; c < NUM_HW_COUNTERS; c++) counted[c] += after.values[c] - before.values[c];
+        }
+        frames++;
+    }
+    
+    ParticleBenchResult r;
+    r.mode = mode;
+    r.particles = system.particles.size();
+    r.threads = threads;
+    r.frames = frames;
+    r.nsPerParticleFrame = elapsed * 1000.0 / ((double) frames * r.particles);
+    r.particlesPerSecond = (double) frames * r.particles / (elapsed * 0.000001);
+    r.bytesPerParticle = bytesPerParticle(system);
+    r.hasCounters = counting;
+    for(int c = 0; c < NUM_HW_COUNTERS; c++){
+        r.counters[c] = counted[c] / ((double) frames * r.particles);
+    }
+    return r;
+}
+
+//--------------------------------------------------------------
+
+void ParticleBench::feed(ParticleSystem & system, int frame){
+    
+    // what ofApp hands over once per frame: one body, the global flow and the local flow field.
+    // the flow swings left and right past the wave threshold every couple of seconds.
+    // a recorded stream replaces all of it, apart from the mode being measured.
+    if(stream.size() > 0){
+        int mode = system.modeCounter;
+        stream.apply(frame % stream.size(), system);
+        system.modeCounter = mode;
+        return;
+    }
+    
+    float t = frame / 60.0;
+    makeBody(frame, body);
+    system.setNumBodies(1);
+    system.receiveBody(0, body);
+    system.receiveFlow(4 * sin(t * 3), cos(t * 2));
+    
+    // a patch of motion following the body's centre
+    ofPoint centre = body.getCentroid2D();
+    ofRectangle screen(0, 0, ofGetWidth(), ofGetHeight());
+    for(int y = 0; y < FlowGrid::rows; y++){
+        for(int x = 0; x < FlowGrid::cols; x++){
+            float cx = (x + 0.5) * screen.width / FlowGrid::cols;
+            float cy = (y + 0.5) * screen.height / FlowGrid::rows;
+            float falloff = exp(-ofDistSquared(cx, cy, centre.x, centre.y) / (300.0 * 300.0));
+            grid.data[(y * FlowGrid::cols + x) * 2] = 4 * sin(t * 3) * falloff;
+            grid.data[(y * FlowGrid::cols + x) * 2 + 1] = cos(t * 2) * falloff;
+        }
+    }
+    system.receiveFlowField(grid, screen);
+}
+
+//--------------------------------------------------------------
+
+void ParticleBench::makeBody(int frame, ofPolyline & out){
+    
+    out.clear();
+    
+    // recorded: the coarse body points FlowBenchmark saved (decimated colour pixels), back in screen space
+    if(!sessionOutlines.empty()){
+        const vector<ofPoint> & points = sessionOutlines[frame % sessionOutlines.size()];
+        for(int i = 0; i < points.size(); i++){
+            out.addVertex(180 + 640 - points[i].x * 4, 50 + points[i].y * 4);
+        }
+        out.close();
+        return;
+    }
+    
+    // synthetic: a wobbling upright ellipse swaying side to side, 120 vertices like the physics outline
+    float t = frame / 60.0;
+    ofPoint centre(ofGetWidth() / 2 + 200 * sin(t), ofGetHeight() / 2);
+    for(int i = 0; i < 120; i++){
+        float a = TWO_PI * i / 120;
+        float wobble = 1 + 0.1 * sin(a * 5 + t * 4);
+        out.addVertex(centre.x + cos(a) * 140 * wobble, centre.y + sin(a) * 320 * wobble);
+    }
+    out.close();
+}
+
+//--------------------------------------------------------------
+
+bool ParticleBench::loadSession(const string & dir){
+    
+    sessionOutlines.clear();
+    for(int frame = 0; ; frame++){
+        char name[32];
+        sprintf(name, "/frame_%05d.txt", frame);
+        ifstream file(ofToDataPath(dir + name).c_str());
+        if(!file.is_open()) break;
+        
+        vector<ofPoint> points;
+        float x, y;
+        while(file >> x >> y) points.push_back(ofPoint(x, y));
+        if(points.size() >= 3) sessionOutlines.push_back(points);
+    }
+    
+    ofLogNotice("ParticleBench") << "loaded " << sessionOutlines.size() << " recorded outlines from " << dir;
+    return !sessionOutlines.empty();
+}
+
+//--------------------------------------------------------------
+
+double ParticleBench::bytesPerParticle(ParticleSystem & system){
+    
+    // the particle, its shape points, its smoother and the system's per particle group / percent
+    if(system.particles.empty()) return 0;
+    const Particle & p = system.particles[0];
+    return sizeof(Particle) + p.shapePoints.capacity() * sizeof(ofPoint) + sizeof(ParameterSmoother)
+    + sizeof(int) + sizeof(float);
+}
+
+//--------------------------------------------------------------
+
+void ParticleBench::writeJson(const string & path, const vector<ParticleBenchResult> & results){
+    
+    // one result per line, which is also what loadJson expects
+    ofstream json(ofToDataPath(path).c_str());
+    json << "{\"hardwareThreads\": " << std::thread::hardware_concurrency()
+         << ", \"session\": \"" << sessionDir << "\", \"results\": [\n";
+    for(int i = 0; i < results.size(); i++){
+        const ParticleBenchResult & r = results[i];
+        json << "{\"mode\": " << r.mode << ", \"particles\": " << r.particles << ", \"threads\": " << r.threads
+             << ", \"frames\": " << r.frames << ", \"nsPerParticleFrame\": " << r.nsPerParticleFrame
+             << ", \"particlesPerSecond\": " << r.particlesPerSecond << ", \"bytesPerParticle\": " << r.bytesPerParticle;
+        if(r.hasCounters){
+            json << ", \"cyclesPerParticle\": " << r.counters[HW_CYCLES] << ", \"instructionsPerParticle\": " << r.counters[HW_INSTRUCTIONS]
+                 << ", \"ipc\": " << (r.counters[HW_CYCLES] > 0 ? r.counters[HW_INSTRUCTIONS] / r.counters[HW_CYCLES] : 0)
+                 << ", \"l1dMissesPerParticle\": " << r.counters[HW_L1D_MISSES] << ", \"llcMissesPerParticle\": " << r.counters[HW_LLC_MISSES]
+                 << ", \"branchMissesPerParticle\": " << r.counters[HW_BRANCH_MISSES];
+        }
+        json << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "]}\n";
+}
+
+//--------------------------------------------------------------
+
+static double jsonNumber(const string & line, const string & key){
+    
+    size_t at = line.find("\"" + key + "\": ");
+    if(at == string::npos) return 0;
+    return atof(line.c_str() + at + key.size() + 4);
+}
+
+//--------------------------------------------------------------
+
+bool ParticleBench::loadJson(const string & path, vector<ParticleBenchResult> & results){
+    
+    ifstream json(ofToDataPath(path).c_str());
+    if(!json.is_open()) return false;
+    
+    string line;
+    while(getline(json, line)){
+        if(line.find("\"nsPerParticleFrame\"") == string::npos) continue;
+        ParticleBenchResult r;
+        r.mode = jsonNumber(line, "mode");
+        r.particles = jsonNumber(line, "particles");
+        r.threads = jsonNumber(line, "threads");
+        r.frames = jsonNumber(line, "frames");
+        r.nsPerParticleFrame = jsonNumber(line, "nsPerParticleFrame");
+        r.particlesPerSecond = jsonNumber(line, "particlesPerSecond");
+        r.bytesPerParticle = jsonNumber(line, "bytesPerParticle");
+        r.hasCounters = false;
+        results.push_back(r);
+    }
+    return !results.empty();
+}
+
+//--------------------------------------------------------------
+
+int ParticleBench::compare(const vector<ParticleBenchResult> & baseline, const vector<ParticleBenchResult> & results){
+    
+    int regressions = 0;
+    for(int i = 0; i < results.size(); i++){
+        const ParticleBenchResult & r = results[i];
+        for(int j = 0; j < baseline.size(); j++){
+            const ParticleBenchResult & b = baseline[j];
+            if(b.mode != r.mode || b.particles != r.particles || b.threads != r.threads || b.nsPerParticleFrame <= 0) continue;
+            
+            double ratio = r.nsPerParticleFrame / b.nsPerParticleFrame;
+            string label = "mode " + ofToString(r.mode) + ", " + ofToString(r.particles) + " particles, " + ofToString(r.threads) + " threads";
+            if(ratio > 1 + tolerance){
+                ofLogWarning("ParticleBench") << "REGRESSION " << label << ": " << ofToString(b.nsPerParticleFrame, 1)
+                << " -> " << ofToString(r.nsPerParticleFrame, 1) << " ns (" << ofToString((ratio - 1) * 100, 0) << "% slower)";
+                regressions++;
+            } else if(ratio < 1 - tolerance){
+                ofLogNotice("ParticleBench") << "faster " << label << ": " << ofToString(b.nsPerParticleFrame, 1)
+                << " -> " << ofToString(r.nsPerParticleFrame, 1) << " ns";
+            }
+            break;
+        }
+    }
+    
+    ofLogNotice("ParticleBench") << regressions << " regressions against the baseline (tolerance " << tolerance * 100 << "%)";
+    return regressions;
+}
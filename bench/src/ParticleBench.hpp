@@ -0,0 +1,78 @@
+//
+//  ParticleBench.hpp
+//  bench
+//
+//  Created by agent on 19/10/26.
+//
+
+// Drives ParticleSystem with no window and no kinect: a synthetic (or recorded) body outline and
+// a synthetic flow signal, in each of the four modes, for 100 .. 1M particles and 1 .. N threads.
+// Results go to bin/data/bench-<timestamp>.json and are compared against bin/data/baseline.json.
+// With --counters the single threaded runs also carry cycles, instructions and misses per particle.
+
+#pragma once
+
+#ifndef ParticleBench_hpp
+#define ParticleBench_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ParticleSystem.hpp"
+#include "HardwareCounters.hpp"
+#include "InputRecording.hpp"
+
+#endif /* ParticleBench_hpp */
+
+
+struct ParticleBenchResult{
+    int mode;
+    int particles;
+    int threads;
+    int frames;
+    double nsPerParticleFrame;
+    double particlesPerSecond;      // particle updates per second
+    double bytesPerParticle;
+    
+    // --counters, single threaded runs only (the counters follow the calling thread), per particle per frame
+    bool hasCounters;
+    double counters[NUM_HW_COUNTERS];
+};
+
+
+class ParticleBench{
+    
+public:
+    ParticleBench();
+    
+    // returns non zero when something got slower than the baseline
+    int run(const vector<string> & args);
+    
+    int minParticles;
+    int maxParticles;
+    int maxThreads;
+    float secondsPerRun;            // each (mode, particles, threads) runs at least this long
+    int minFrames;
+    int warmupFrames;
+    float tolerance;                // slower than baseline by more than this is a regression
+    string sessionDir;              // recorded FlowBenchmark session to take the body outline from
+    string streamPath;              // or every particle input from an InputRecorder / jank dump recording
+    bool saveBaseline;
+    bool useCounters;
+    
+private:
+    ParticleBenchResult runOne(ParticleSystem & system, int mode, int threads);
+    void feed(ParticleSystem & system, int frame);
+    void makeBody(int frame, ofPolyline & out);
+    bool loadSession(const string & dir);
+    double bytesPerParticle(ParticleSystem & system);
+    
+    void writeJson(const string & path, const vector<ParticleBenchResult> & results);
+    bool loadJson(const string & path, vector<ParticleBenchResult> & results);
+    int compare(const vector<ParticleBenchResult> & baseline, const vector<ParticleBenchResult> & results);
+    
+    vector<vector<ofPoint> > sessionOutlines;
+    InputPlayer stream;
+    ofPolyline body;
+    FlowGrid grid;
+    
+};
@@ -0,0 +1,20 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+// usage: bench [--max-particles N] [--max-threads N] [--seconds S] [--session DIR] [--save-baseline]
+//        bench --micro [--particles N] [--samples N] [--filter NAME]
+int main(int argc, char * argv[]) {
+    
+    // no window and no GL, but the same screen size the app runs at (particles wrap at its edges)
+    ofAppNoWindow window;
+    ofSetupOpenGL(&window, 1920, 1080, OF_WINDOW);
+    
+    ofApp * app = new ofApp();
+    for (int i = 1; i < argc; i++) {
+        app->args.push_back(argv[i]);
+    }
+    // oF owns (and deletes) the app once it runs; ofApp::setup hands its exit code to ofExit,
+    // which is what ofRunApp returns
+    return ofRunApp(app);
+}
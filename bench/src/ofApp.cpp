@@ -0,0 +1,15 @@
+#include "ofApp.h"
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    
+    ofSetLogLevel(OF_LOG_NOTICE);
+    if(std::find(args.begin(), args.end(), "--micro") != args.end()) {
+        exitCode = micro.run(args);
+    } else if(std::find(args.begin(), args.end(), "--determinism") != args.end()) {
+        exitCode = determinism.run(args);
+    } else {
+        exitCode = bench.run(args);
+    }
+    ofExit(exitCode);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ParticleBench.hpp"
+#include "MicroBench.hpp"
+#include "DeterminismHarness.hpp"
+
+// runs the benchmark once from setup, then quits
+class ofApp : public ofBaseApp{
+
+public:
+    void setup();
+    
+    vector <string> args;
+    int exitCode;
+    ParticleBench bench;
+    MicroBench micro;
+    DeterminismHarness determinism;
+};
@@ -0,0 +1,209 @@
+//
+//  AllocationTracker.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "AllocationTracker.hpp"
+#include <new>
+#include <cstdlib>
+#include <execinfo.h>
+#include <unistd.h>
+
+bool AllocationTracker::strict = false;
+int AllocationTracker::warmupFrames = 120;
+int AllocationTracker::maxReportsPerFrame = 4;
+AllocationTracker::ThreadCounters * AllocationTracker::counters[maxThreads];
+std::atomic<int> AllocationTracker::numCounters(0);
+AllocationCounts AllocationTracker::last[maxTags];
+AllocationCounts AllocationTracker::perFrame[maxTags];
+AllocationCounts AllocationTracker::frameTotal;
+int AllocationTracker::strictFrames = 0;
+std::atomic<int> AllocationTracker::reportsThisFrame(0);
+
+// per thread state is plain data, so reading it can't allocate.
+// 'busy' stops the tracker counting (or reporting) its own allocations.
+static thread_local int currentTag = -1;
+static thread_local bool busy = false;
+static thread_local void * threadCounters = NULL;
+
+//--------------------------------------------------------------
+
+void AllocationTracker::setTag(int tag){
+    currentTag = tag;
+}
+
+//--------------------------------------------------------------
+
+int AllocationTracker::getTag(){
+    return currentTag;
+}
+
+//--------------------------------------------------------------
+
+AllocationTracker::ThreadCounters * AllocationTracker::getCounters(){
+    
+    if(threadCounters) return (ThreadCounters *) threadCounters;
+    
+    // first allocation on this thread: make its counters (never freed, like the profiler rings)
+    busy = true;
+    ThreadCounters * c = new ThreadCounters();
+    for(int i = 0; i < maxTags; i++){
+        c->allocations[i].store(0);
+        c->bytes[i].store(0);
+        c->frees[i].store(0);
+    }
+    int index = numCounters.fetch_add(1);
+    if(index < maxThreads) counters[index] = c;
+    threadCounters = c;
+    busy = false;
+    return c;
+}
+
+//--------------------------------------------------------------
+
+void AllocationTracker::recordAllocation(size_t size){
+    
+    if(busy) return;
+    
+    // only the owning thread writes its counters, relaxed is enough
+    ThreadCounters * c = getCounters();
+    int tag = currentTag >= 0 && currentTag < untagged ? currentTag : untagged;
+    c->allocations[tag].store(c->allocations[tag].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    c->bytes[tag].store(c->bytes[tag].load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    
+    if(strict && strictFrames > warmupFrames) report(size);
+}
+
+//--------------------------------------------------------------
+
+void AllocationTracker::recordFree(){
+    
+    if(busy) return;
+    
+    ThreadCounters * c = getCounters();
+    int tag = currentTag >= 0 && currentTag < untagged ? currentTag : untagged;
+    c->frees[tag].store(c->frees[tag].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void AllocationTracker::report(size_t size){
+    
+    if(reportsThisFrame.fetch_add(1) >= maxReportsPerFrame) return;
+    
+    // straight to stderr: anything fancier would allocate in the middle of an allocation
+    busy = true;
+    char line[96];
+    int length = snprintf(line, sizeof(line), "\n[AllocationTracker] %zu bytes allocated after warm-up, tag %d:\n", size, currentTag);
+    if(length > 0) write(STDERR_FILENO, line, min<int>(length, sizeof(line) - 1));
+    
+    void * frames[32];
+    int depth = backtrace(frames, 32);
+    backtrace_symbols_fd(frames + 2, max(0, depth - 2), STDERR_FILENO);
+    busy = false;
+}
+
+//--------------------------------------------------------------
+
+void AllocationTracker::frame(){
+    
+    busy = true;
+    
+    AllocationCounts now[maxTags];
+    memset(now, 0, sizeof(now));
+    int numThreads = min<int>(numCounters.load(), maxThreads);
+    for(int t = 0; t < numThreads; t++){
+        ThreadCounters * c = counters[t];
+        if(!c) continue;    // registering right now
+        for(int i = 0; i < maxTags; i++){
+            now[i].allocations += c->allocations[i].load(std::memory_order_relaxed);
+            now[i].bytes += c->bytes[i].load(std::memory_order_relaxed);
+            now[i].frees += c->frees[i].load(std::memory_order_relaxed);
+        }
+    }
+    
+    memset(&frameTotal, 0, sizeof(frameTotal));
+    for(int i = 0; i < maxTags; i++){
+        perFrame[i].allocations = now[i].allocations - last[i].allocations;
+        perFrame[i].bytes = now[i].bytes - last[i].bytes;
+        perFrame[i].frees = now[i].frees - last[i].frees;
+        frameTotal.allocations += perFrame[i].allocations;
+        frameTotal.bytes += perFrame[i].bytes;
+        frameTotal.frees += perFrame[i].frees;
+        last[i] = now[i];
+    }
+    
+    strictFrames = strict ? strictFrames + 1 : 0;
+    reportsThisFrame.store(0);
+    busy = false;
+}
+
+//--------------------------------------------------------------
+
+const AllocationCounts & AllocationTracker::getFrameCounts(int tag){
+    return perFrame[tag >= 0 && tag < untagged ? tag : untagged];
+}
+
+//--------------------------------------------------------------
+
+const AllocationCounts & AllocationTracker::getFrameTotal(){
+    return frameTotal;
+}
+
+
+#ifndef ALLOCATION_TRACKER_DISABLED
+
+//--------------------------------------------------------------
+// the global operators. Everything ends up in malloc / free, the tracker only counts.
+
+void * operator new(size_t size){
+    AllocationTracker::recordAllocation(size);
+    void * p = malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+
+void * operator new[](size_t size){
+    AllocationTracker::recordAllocation(size);
+    void * p = malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept{
+    AllocationTracker::recordAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept{
+    AllocationTracker::recordAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void * p) noexcept{
+    if(!p) return;
+    AllocationTracker::recordFree();
+    free(p);
+}
+
+void operator delete[](void * p) noexcept{
+    if(!p) return;
+    AllocationTracker::recordFree();
+    free(p);
+}
+
+void operator delete(void * p, const std::nothrow_t &) noexcept{
+    if(!p) return;
+    AllocationTracker::recordFree();
+    free(p);
+}
+
+void operator delete[](void * p, const std::nothrow_t &) noexcept{
+    if(!p) return;
+    AllocationTracker::recordFree();
+    free(p);
+}
+
+#endif
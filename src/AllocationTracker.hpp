@@ -0,0 +1,76 @@
+//
+//  AllocationTracker.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Counts every heap allocation (global operator new / delete are replaced in the .cpp),
+// per thread and tagged with the profiler stage running at the time, so the HUD can show
+// allocations and bytes per frame for each stage. The aim is a steady state with none at all.
+// In strict mode any allocation after the warm-up frames prints a backtrace to stderr.
+// Build with ALLOCATION_TRACKER_DISABLED defined to leave the global operators alone.
+
+#pragma once
+
+#ifndef AllocationTracker_hpp
+#define AllocationTracker_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include "ofMain.h"
+
+#endif /* AllocationTracker_hpp */
+
+
+struct AllocationCounts{
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t frees;
+};
+
+
+class AllocationTracker{
+    
+public:
+    static const int maxTags = 16;          // profiler stages, plus 'untagged' in the last slot
+    static const int untagged = maxTags - 1;
+    static const int maxThreads = 64;
+    
+    // the stage allocations on this thread are counted against (-1 = untagged)
+    static void setTag(int tag);
+    static int getTag();
+    
+    // main thread, once per frame: works out the per frame numbers and handles strict mode's warm-up
+    static void frame();
+    static const AllocationCounts & getFrameCounts(int tag);
+    static const AllocationCounts & getFrameTotal();
+    
+    static bool strict;
+    static int warmupFrames;            // strict mode stays quiet for this many frames after it's turned on
+    static int maxReportsPerFrame;
+    
+    // called by the operator new / delete replacements
+    static void recordAllocation(size_t size);
+    static void recordFree();
+    
+private:
+    struct ThreadCounters{
+        std::atomic<uint64_t> allocations[maxTags];
+        std::atomic<uint64_t> bytes[maxTags];
+        std::atomic<uint64_t> frees[maxTags];
+    };
+    
+    static ThreadCounters * getCounters();
+    static void report(size_t size);
+    
+    // plain arrays, not vectors: allocations happen before static constructors have run
+    static ThreadCounters * counters[maxThreads];
+    static std::atomic<int> numCounters;
+    static AllocationCounts last[maxTags];
+    static AllocationCounts perFrame[maxTags];
+    static AllocationCounts frameTotal;
+    static int strictFrames;
+    static std::atomic<int> reportsThisFrame;
+    
+};
@@ -0,0 +1,42 @@
+//
+//  ArcLengthSampler.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "ArcLengthSampler.hpp"
+
+//--------------------------------------------------------------
+
+void ArcLengthSampler::sample(const ofPolyline & line, const float * percents, int count, ofPoint * out){
+    
+    const vector<ofPoint> & points = line.getVertices();
+    int numPoints = points.size();
+    if(numPoints < 2){
+        for(int i = 0; i < count; i++) out[i] = ofPoint();
+        return;
+    }
+    
+    // a closed outline has one more segment, back to the first point
+    int numSegments = line.isClosed() ? numPoints : numPoints - 1;
+    lengths.resize(numSegments + 1);
+    lengths[0] = 0;
+    for(int s = 0; s < numSegments; s++){
+        lengths[s + 1] = lengths[s] + points[s].distance(points[(s + 1) % numPoints]);
+    }
+    float total = lengths[numSegments];
+    
+    // one pass: the segment only ever moves forward
+    int s = 0;
+    for(int i = 0; i < count; i++){
+        float length = ofClamp(percents[i], 0, 1) * total;
+        while(s < numSegments - 1 && lengths[s + 1] < length) s++;
+        
+        float segmentLength = lengths[s + 1] - lengths[s];
+        float t = segmentLength > 0 ? (length - lengths[s]) / segmentLength : 0;
+        const ofPoint & a = points[s];
+        const ofPoint & b = points[(s + 1) % numPoints];
+        out[i] = a + (b - a) * t;
+    }
+}
@@ -0,0 +1,31 @@
+//
+//  ArcLengthSampler.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Points at many percentages along one polyline in a single walk over its segments, instead of
+// a binary search per point like ofPolyline::getPointAtPercent. The percentages have to be in
+// ascending order, which a particle group's are. Same points as getPointAtPercent, closed or open.
+
+#pragma once
+
+#ifndef ArcLengthSampler_hpp
+#define ArcLengthSampler_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* ArcLengthSampler_hpp */
+
+
+class ArcLengthSampler{
+    
+public:
+    void sample(const ofPolyline & line, const float * percents, int count, ofPoint * out);
+    
+private:
+    vector<float> lengths;          // running length at the start of each segment, reused
+    
+};
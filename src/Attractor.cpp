@@ -19,7 +19,7 @@ Attractor::Attractor(ofPoint pos, float s){
 
 
 
-ofPoint Attractor::attract(Particle p){
+ofPoint Attractor::attract(const Particle & p){
     
     //calculate direction of force
     ofPoint force = position - p.position;
@@ -22,7 +22,7 @@ class Attractor{
     Attractor(ofPoint pos, float s);
     
     //functions
-    ofPoint attract(Particle p);
+    ofPoint attract(const Particle & p);   // by reference: a copy of Particle costs a heap allocation (its shape points)
     
     //variables
     ofPoint position;
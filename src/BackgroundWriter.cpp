@@ -0,0 +1,73 @@
+//
+//  BackgroundWriter.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "BackgroundWriter.hpp"
+
+//--------------------------------------------------------------
+
+BackgroundWriter::BackgroundWriter(){
+}
+
+//--------------------------------------------------------------
+
+BackgroundWriter::~BackgroundWriter(){
+    stop();
+}
+
+//--------------------------------------------------------------
+
+void BackgroundWriter::setup(){
+    startThread();
+}
+
+//--------------------------------------------------------------
+
+void BackgroundWriter::stop(){
+    
+    if(!isThreadRunning()) return;
+    stopThread();
+    
+    // same as TelemetryPublisher: with the lock taken the thread is either waiting or will see the flag
+    { std::lock_guard<std::mutex> lck(mutex); }
+    wake.notify_all();
+    waitForThread(false);
+}
+
+//--------------------------------------------------------------
+
+void BackgroundWriter::add(const std::function<void()> & job){
+    
+    if(!isThreadRunning()){
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        jobs.push_back(job);
+    }
+    wake.notify_one();
+}
+
+//--------------------------------------------------------------
+
+void BackgroundWriter::threadedFunction(){
+    
+    Profiler::setThreadName("writer");
+    
+    // after stop() the queue is still emptied, so nothing asked for is lost on exit
+    while(true){
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lck(mutex);
+            wake.wait(lck, [this]{ return !jobs.empty() || !isThreadRunning(); });
+            if(jobs.empty()) break;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,44 @@
+//
+//  BackgroundWriter.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// One long lived thread for the files the app writes while it runs (traces, jank dumps), so a
+// save never starts a thread of its own. Jobs run one at a time in the order they were added.
+// Without a running writer a job runs straight away on the caller's thread.
+
+#pragma once
+
+#ifndef BackgroundWriter_hpp
+#define BackgroundWriter_hpp
+
+#include <stdio.h>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include "ofMain.h"
+#include "Profiler.hpp"
+
+#endif /* BackgroundWriter_hpp */
+
+
+class BackgroundWriter : public ofThread{
+    
+public:
+    BackgroundWriter();
+    ~BackgroundWriter();
+    
+    void setup();
+    void stop();                        // finishes what's queued first
+    
+    void add(const std::function<void()> & job);
+    
+private:
+    void threadedFunction();
+    
+    std::deque<std::function<void()> > jobs;    // shared, under the lock
+    std::condition_variable wake;
+    
+};
@@ -0,0 +1,121 @@
+//
+//  BlobTracker.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "BlobTracker.hpp"
+
+//--------------------------------------------------------------
+
+BlobTracker::BlobTracker(){
+    
+    // same limit as the contour finder
+    maxTracks = 20;
+    maxMissingFrames = 10;
+    maxDistance = 120;
+    nextId = 0;
+    numSlots = 0;
+    slotTaken.assign(maxTracks, false);
+    
+    tracks.reserve(maxTracks);
+    matches.reserve(maxTracks * maxTracks);
+    trackTaken.reserve(maxTracks);
+    candidateTaken.reserve(maxTracks);
+}
+
+//--------------------------------------------------------------
+
+void BlobTracker::update(const vector<BodyContour> & contours, const vector<int> & candidates){
+    
+    // one slot per possible track, even if maxTracks was raised after construction
+    if(slotTaken.size() < maxTracks) slotTaken.resize(maxTracks, false);
+    
+    // every possible pairing that is close enough or overlaps, cheapest first
+    matches.clear();
+    for(int t = 0; t < tracks.size(); t++){
+        for(int c = 0; c < candidates.size(); c++){
+            
+            const BodyContour & contour = contours[candidates[c]];
+            float dist = tracks[t].centroid.distance(contour.centroid);
+            
+            ofRectangle overlap = tracks[t].bounds.getIntersection(contour.bounds);
+            float unionArea = tracks[t].bounds.getArea() + contour.bounds.getArea() - overlap.getArea();
+            float iou = unionArea > 0 ? overlap.getArea() / unionArea : 0;
+            
+            if(dist > maxDistance && iou <= 0) continue;
+            
+            Match m;
+            m.cost = dist / maxDistance + (1. - iou);
+            m.track = t;
+            m.candidate = c;
+            matches.push_back(m);
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+    
+    // greedy assignment - with at most 20 bodies this is as good as hungarian in practice
+    trackTaken.assign(tracks.size(), false);
+    candidateTaken.assign(candidates.size(), false);
+    for(int i = 0; i < matches.size(); i++){
+        const Match & m = matches[i];
+        if(trackTaken[m.track] || candidateTaken[m.candidate]) continue;
+        trackTaken[m.track] = true;
+        candidateTaken[m.candidate] = true;
+        
+        const BodyContour & contour = contours[candidates[m.candidate]];
+        TrackedBlob & track = tracks[m.track];
+        track.contour = candidates[m.candidate];
+        track.centroid = contour.centroid;
+        track.bounds = contour.bounds;
+        track.area = contour.area;
+        track.age++;
+        track.missing = 0;
+    }
+    
+    // tracks nobody matched wait a few frames before they are dropped
+    for(int t = tracks.size() - 1; t >= 0; t--){
+        if(trackTaken[t]) continue;
+        tracks[t].contour = -1;
+        tracks[t].age++;
+        tracks[t].missing++;
+        if(tracks[t].missing > maxMissingFrames){
+            slotTaken[tracks[t].slot] = false;
+            tracks.erase(tracks.begin() + t);
+        }
+    }
+    
+    // anything left over is someone new
+    for(int c = 0; c < candidates.size() && tracks.size() < maxTracks; c++){
+        if(candidateTaken[c]) continue;
+        
+        const BodyContour & contour = contours[candidates[c]];
+        TrackedBlob track;
+        track.id = nextId++;
+        track.slot = std::find(slotTaken.begin(), slotTaken.end(), false) - slotTaken.begin();
+        slotTaken[track.slot] = true;
+        track.contour = candidates[c];
+        track.centroid = contour.centroid;
+        track.bounds = contour.bounds;
+        track.area = contour.area;
+        track.age = 0;
+        track.missing = 0;
+        tracks.push_back(track);
+    }
+    
+    numSlots = 0;
+    for(int t = 0; t < tracks.size(); t++) numSlots = max(numSlots, tracks[t].slot + 1);
+}
+
+//--------------------------------------------------------------
+
+int BlobTracker::getNumSlots(){
+    return numSlots;
+}
+
+//--------------------------------------------------------------
+
+bool BlobTracker::isSlotTaken(int slot){
+    return slot >= 0 && slot < slotTaken.size() && slotTaken[slot];
+}
@@ -0,0 +1,74 @@
+//
+//  BlobTracker.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Matches contours from frame to frame (centroid distance + bounding box overlap, greedy assignment)
+// and gives each body a persistent id, so several visitors can each drive their own group of particles
+// without the choice flickering between them. Everything is sized for maxTracks up front.
+// Each body also gets a slot (its particle group) that it keeps for as long as it's tracked;
+// slots freed by bodies leaving are handed to the next new ones.
+
+#pragma once
+
+#ifndef BlobTracker_hpp
+#define BlobTracker_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "BodyContourFinder.hpp"
+#include "OneEuroContourFilter.hpp"
+
+#endif /* BlobTracker_hpp */
+
+
+struct TrackedBlob{
+    int id;
+    int slot;               // particle group, stable while tracked (tracks themselves shift when one is dropped)
+    int contour;            // index into this frame's contours, -1 while missing
+    ofPoint centroid;
+    ofRectangle bounds;
+    float area;
+    int age;                // frames since first seen
+    int missing;            // frames since last matched
+    
+    ofPolyline outline;         // filled in by the app, kept while the body is briefly missing
+    ofPolyline outlineCoarse;
+    OneEuroContourFilter filter;    // temporal smoothing of outlineCoarse, state follows the body
+};
+
+
+class BlobTracker{
+    
+public:
+    BlobTracker();
+    
+    // candidates are the indices of the contours worth tracking this frame
+    void update(const vector<BodyContour> & contours, const vector<int> & candidates);
+    
+    vector<TrackedBlob> tracks;     // oldest (lowest id) first
+    int getNumSlots();              // highest slot in use + 1
+    bool isSlotTaken(int slot);     // someone is in this slot (slots below getNumSlots can be empty)
+    
+    int maxTracks;
+    int maxMissingFrames;           // how long a body survives without a match
+    float maxDistance;              // furthest a centroid can move between frames (pixels)
+    
+private:
+    struct Match{
+        float cost;
+        int track;
+        int candidate;
+        bool operator<(const Match & m) const { return cost < m.cost; }
+    };
+    
+    vector<Match> matches;
+    vector<bool> trackTaken;
+    vector<bool> candidateTaken;
+    vector<bool> slotTaken;
+    int nextId;
+    int numSlots;
+    
+};
@@ -0,0 +1,130 @@
+//
+//  BodyContourFinder.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "BodyContourFinder.hpp"
+
+//--------------------------------------------------------------
+
+BodyContourFinder::BodyContourFinder(){
+    
+    // same limits the old ofxCvContourFinder call used
+    minArea = 2000;
+    maxArea = 640 * 480 / 2;
+    maxContours = 20;
+    width = 0;
+    height = 0;
+}
+
+//--------------------------------------------------------------
+
+void BodyContourFinder::setup(int _width, int _height){
+    
+    width = _width;
+    height = _height;
+    maxArea = width * height / 2;
+    work.create(height, width, CV_8UC1);
+    
+    contours.reserve(maxContours);
+    points.reserve(width * 4);
+}
+
+//--------------------------------------------------------------
+
+int BodyContourFinder::findContours(const cv::Mat & mask, const ofRectangle & roi, float scale){
+    
+    contours.clear();
+    points.clear();
+    
+    float toFull = 1 / scale;
+    float areaToFull = toFull * toFull;
+    cv::Rect r(roi.x * scale, roi.y * scale, ceil(roi.width * scale), ceil(roi.height * scale));
+    r &= cv::Rect(0, 0, mask.cols, mask.rows);
+    if(r.area() == 0) return 0;
+    
+    // only the roi gets copied, and the offset puts points back into full frame coordinates
+    if(work.size() != mask.size()) work.create(mask.size(), CV_8UC1);
+    cv::Mat workRoi = work(r);
+    mask(r).copyTo(workRoi);
+    cv::findContours(workRoi, found, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE, r.tl());
+    
+    // filter by area and keep the biggest maxContours
+    order.clear();
+    areas.resize(found.size());
+    for(int i = 0; i < found.size(); i++){
+        areas[i] = cv::contourArea(found[i]) * areaToFull;
+        if(areas[i] >= minArea && areas[i] <= maxArea){
+            order.push_back(i);
+        }
+    }
+    
+    const vector<double> & a = areas;
+    std::sort(order.begin(), order.end(), [&a](int i, int j){ return a[i] > a[j]; });
+    if(order.size() > maxContours) order.resize(maxContours);
+    
+    // copy the kept contours into the flat buffer
+    for(int k = 0; k < order.size(); k++){
+        const vector<cv::Point> & c = found[order[k]];
+        
+        BodyContour contour;
+        contour.start = points.size();
+        contour.count = c.size();
+        contour.area = areas[order[k]];
+        
+        cv::Rect b = cv::boundingRect(c);
+        contour.bounds.set(b.x * toFull, b.y * toFull, b.width * toFull, b.height * toFull);
+        
+        cv::Moments m = cv::moments(c);
+        contour.centroid.set(m.m10 / m.m00 * toFull, m.m01 / m.m00 * toFull);
+        
+        for(int i = 0; i < c.size(); i++){
+            points.push_back(ofPoint(c[i].x * toFull, c[i].y * toFull));
+        }
+        
+        contours.push_back(contour);
+    }
+    
+    return contours.size();
+}
+
+//--------------------------------------------------------------
+
+void BodyContourFinder::draw(float x, float y, float w, float h){
+    
+    ofPushStyle();
+    ofPushMatrix();
+    ofTranslate(x, y);
+    ofScale(w / width, h / height);
+    
+    ofNoFill();
+    for(int i = 0; i < contours.size(); i++){
+        ofSetColor(0, 255, 255);
+        ofBeginShape();
+        const ofPoint * p = getPoints(i);
+        for(int j = 0; j < contours[i].count; j++){
+            ofVertex(p[j]);
+        }
+        ofEndShape(true);
+        
+        ofSetColor(255, 0, 255);
+        ofDrawRectangle(contours[i].bounds);
+    }
+    
+    ofPopMatrix();
+    ofPopStyle();
+}
+
+//--------------------------------------------------------------
+
+int BodyContourFinder::size(){
+    return contours.size();
+}
+
+//--------------------------------------------------------------
+
+const ofPoint * BodyContourFinder::getPoints(int i){
+    return points.data() + contours[i].start;
+}
@@ -0,0 +1,63 @@
+//
+//  BodyContourFinder.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Contour finding straight on a cv::Mat view of our own mask (no IplImage / ofxCvBlob copies).
+// All contour points go into one flat, reused buffer; each contour is just a range in it.
+
+#pragma once
+
+#ifndef BodyContourFinder_hpp
+#define BodyContourFinder_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#endif /* BodyContourFinder_hpp */
+
+
+struct BodyContour{
+    int start;              // index of the first point in BodyContourFinder::points
+    int count;
+    float area;
+    ofRectangle bounds;
+    ofPoint centroid;
+};
+
+
+class BodyContourFinder{
+    
+public:
+    BodyContourFinder();
+    
+    void setup(int _width, int _height);
+    
+    // finds outer contours of the mask inside roi, largest first. the mask is left untouched.
+    // mask can be a reduced pyramid level (scale = its size relative to full resolution);
+    // roi, points, bounds and areas are always in full mask coordinates.
+    int findContours(const cv::Mat & mask, const ofRectangle & roi, float scale = 1);
+    
+    void draw(float x, float y, float w, float h);
+    
+    int size();
+    const ofPoint * getPoints(int i);
+    
+    vector<BodyContour> contours;
+    vector<ofPoint> points;
+    
+    float minArea;
+    float maxArea;
+    int maxContours;
+    
+private:
+    int width, height;
+    cv::Mat work;                           // cv::findContours scribbles on its input
+    vector<vector<cv::Point> > found;       // reused, so after a few frames it stops allocating
+    vector<int> order;
+    vector<double> areas;
+    
+};
@@ -0,0 +1,136 @@
+//
+//  ContourSimplifier.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "ContourSimplifier.hpp"
+
+//--------------------------------------------------------------
+
+ContourSimplifier::ContourSimplifier(){
+    remaining = 0;
+    first = 0;
+}
+
+//--------------------------------------------------------------
+
+void ContourSimplifier::simplify(const ofPoint * pts, int n, int fineMaxVertices, ofPolyline & fine, int coarseMaxVertices, ofPolyline & coarse){
+    
+    // buffers are members so they only grow, never get reallocated per contour
+    prev.resize(n);
+    next.resize(n);
+    area.resize(n);
+    removed.assign(n, false);
+    heap.clear();
+    remaining = n;
+    first = 0;
+    
+    for(int i = 0; i < n; i++){
+        prev[i] = i == 0 ? n - 1 : i - 1;
+        next[i] = i == n - 1 ? 0 : i + 1;
+    }
+    for(int i = 0; i < n; i++){
+        area[i] = triangleArea(pts, i);
+        heap.push_back(make_pair(area[i], i));
+    }
+    std::make_heap(heap.begin(), heap.end(), std::greater<pair<float, int> >());
+    
+    removeUntil(pts, fineMaxVertices);
+    copyRemaining(pts, fine);
+    
+    removeUntil(pts, std::min(coarseMaxVertices, fineMaxVertices));
+    copyRemaining(pts, coarse);
+}
+
+//--------------------------------------------------------------
+
+void ContourSimplifier::removeUntil(const ofPoint * pts, int maxVertices){
+    
+    // a closed shape needs at least a triangle
+    maxVertices = std::max(maxVertices, 3);
+    
+    while(remaining > maxVertices && !heap.empty()){
+        
+        std::pop_heap(heap.begin(), heap.end(), std::greater<pair<float, int> >());
+        pair<float, int> smallest = heap.back();
+        heap.pop_back();
+        
+        // entries go stale when a neighbour's removal changes a vertex's area - skip them
+        int i = smallest.second;
+        if(removed[i] || smallest.first != area[i]) continue;
+        
+        int p = prev[i];
+        int nx = next[i];
+        next[p] = nx;
+        prev[nx] = p;
+        removed[i] = true;
+        remaining--;
+        if(first == i) first = nx;
+        
+        // neighbours never get less important than what was just removed, so the
+        // removal order stays monotonic (standard Visvalingam)
+        area[p] = std::max(triangleArea(pts, p), smallest.first);
+        heap.push_back(make_pair(area[p], p));
+        std::push_heap(heap.begin(), heap.end(), std::greater<pair<float, int> >());
+        
+        area[nx] = std::max(triangleArea(pts, nx), smallest.first);
+        heap.push_back(make_pair(area[nx], nx));
+        std::push_heap(heap.begin(), heap.end(), std::greater<pair<float, int> >());
+    }
+}
+
+//--------------------------------------------------------------
+
+void ContourSimplifier::copyRemaining(const ofPoint * pts, ofPolyline & out){
+    
+    out.clear();
+    if(remaining == 0) return;
+    
+    int i = first;
+    for(int k = 0; k < remaining; k++){
+        out.addVertex(pts[i]);
+        i = next[i];
+    }
+    out.setClosed(true);
+}
+
+//--------------------------------------------------------------
+
+float ContourSimplifier::triangleArea(const ofPoint * pts, int i){
+    
+    const ofPoint & a = pts[prev[i]];
+    const ofPoint & b = pts[i];
+    const ofPoint & c = pts[next[i]];
+    return fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5;
+}
+
+//--------------------------------------------------------------
+
+void ContourSimplifier::smooth(const ofPolyline & in, int smoothingSize, ofPolyline & out){
+    
+    const vector<ofPoint> & src = in.getVertices();
+    int n = src.size();
+    smoothingSize = ofClamp(smoothingSize, 0, n);
+    
+    weights.resize(max(smoothingSize, 1));
+    for(int j = 1; j < smoothingSize; j++){
+        weights[j] = ofMap(j, 0, smoothingSize, 1, 0);
+    }
+    
+    out.resize(n);
+    for(int i = 0; i < n; i++){
+        ofPoint sum = src[i];
+        float weightSum = 1;
+        for(int j = 1; j < smoothingSize; j++){
+            int left = i - j < 0 ? i - j + n : i - j;
+            int right = i + j >= n ? i + j - n : i + j;
+            sum += (src[left] + src[right]) * weights[j];
+            weightSum += weights[j] * 2;
+        }
+        out[i] = sum / weightSum;
+    }
+    out.setClosed(true);
+    out.flagHasChanged();
+}
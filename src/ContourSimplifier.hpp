@@ -0,0 +1,50 @@
+//
+//  ContourSimplifier.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Visvalingam-Whyatt simplification of closed contours down to a fixed vertex budget.
+// Raw contours come out of the contour finder with a vertex per boundary pixel (hundreds to thousands),
+// so everything downstream (smoothing, the body fill, getPointAtPercent for every particle) gets capped here.
+// One pass produces two levels of detail: a fine one for drawing and a coarse one for the physics.
+
+#pragma once
+
+#ifndef ContourSimplifier_hpp
+#define ContourSimplifier_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* ContourSimplifier_hpp */
+
+
+class ContourSimplifier{
+    
+public:
+    ContourSimplifier();
+    
+    // simplifies the closed contour pts[0..n) to at most fineMaxVertices into fine,
+    // then keeps going down to coarseMaxVertices into coarse (coarseMaxVertices <= fineMaxVertices)
+    void simplify(const ofPoint * pts, int n, int fineMaxVertices, ofPolyline & fine, int coarseMaxVertices, ofPolyline & coarse);
+    
+    // same weighting as ofPolyline::getSmoothed (closed, linear falloff) but writes into an existing polyline
+    void smooth(const ofPolyline & in, int smoothingSize, ofPolyline & out);
+    
+private:
+    void removeUntil(const ofPoint * pts, int maxVertices);
+    void copyRemaining(const ofPoint * pts, ofPolyline & out);
+    float triangleArea(const ofPoint * pts, int i);
+    
+    // ring of the vertices still alive, plus a lazy min-heap of (effective area, vertex)
+    vector<int> prev, next;
+    vector<float> area;
+    vector<bool> removed;
+    vector<pair<float, int> > heap;
+    vector<float> weights;
+    int remaining;
+    int first;
+    
+};
@@ -0,0 +1,254 @@
+//
+//  DepthSegmenter.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "DepthSegmenter.hpp"
+#include <climits>
+
+//--------------------------------------------------------------
+
+DepthSegmenter::DepthSegmenter(){
+    
+    // roughly the same band as the old 8 bit thresholds (208 / 160) with the default kinect clipping
+    nearMM = 1150;
+    farMM = 1800;
+    
+    useBackground = true;
+    toleranceMM = 40;
+    adaptRate = 0.02;
+    absorbFrames = 300;     // ~10s at the kinect's 30fps
+    learnFramesLeft = 0;
+    learned = false;
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::setRange(int _nearMM, int _farMM){
+    
+    // raw depth tops out around 10m, 0 means no reading
+    nearMM = ofClamp(_nearMM, 1, 10000);
+    farMM = ofClamp(_farMM, nearMM, 10000);
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::segment(const ofShortPixels & raw, unsigned char * dst, int dstStride, bool mirror){
+    
+    int w = raw.getWidth();
+    int h = raw.getHeight();
+    int numPixels = w * h;
+    const unsigned short * src = raw.getData();
+    
+    if(background.size() != numPixels){
+        background.assign(numPixels, 0);
+        backgroundLimit.assign(numPixels, USHRT_MAX);
+        stillDepth.assign(numPixels, 0);
+        stillFrames.assign(numPixels, 0);
+        bodyPixels.assign(numPixels, 0);
+        learned = false;
+    }
+    
+    // learn while asked to, then keep following slow changes (chairs moved, doors opened...)
+    if(learnFramesLeft > 0 || (learned && (adaptRate > 0 || absorbFrames > 0))){
+        if(learned) markBodies(w, h, mirror);
+        updateBackground(src, numPixels);
+    }
+    
+    // band-pass as a single unsigned compare: (d - near) wraps around for d < near,
+    // and 0 (no reading) always lands outside the band. No branches in the inner loops,
+    // so the compiler can vectorise them.
+    const unsigned short lo = nearMM;
+    const unsigned short range = farMM - nearMM;
+    
+    // with no background every limit is USHRT_MAX, so the same loop works either way
+    bool subtract = useBackground && learned;
+    
+    for(int y = 0; y < h; y++){
+        const unsigned short * srcRow = src + y * w;
+        const unsigned short * limitRow = backgroundLimit.data() + y * w;
+        unsigned char * dstRow = dst + y * dstStride;
+        
+        if(subtract){
+            if(mirror){
+                const unsigned short * srcEnd = srcRow + w - 1;
+                const unsigned short * limitEnd = limitRow + w - 1;
+                for(int x = 0; x < w; x++){
+                    unsigned short d = srcEnd[-x];
+                    unsigned short band = d - lo;
+                    dstRow[x] = (band <= range) & (d < limitEnd[-x]) ? 255 : 0;
+                }
+            } else {
+                for(int x = 0; x < w; x++){
+                    unsigned short d = srcRow[x];
+                    unsigned short band = d - lo;
+                    dstRow[x] = (band <= range) & (d < limitRow[x]) ? 255 : 0;
+                }
+            }
+        } else {
+            if(mirror){
+                const unsigned short * srcEnd = srcRow + w - 1;
+                for(int x = 0; x < w; x++){
+                    unsigned short d = srcEnd[-x] - lo;
+                    dstRow[x] = d <= range ? 255 : 0;
+                }
+            } else {
+                for(int x = 0; x < w; x++){
+                    unsigned short d = srcRow[x] - lo;
+                    dstRow[x] = d <= range ? 255 : 0;
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::learnBackground(int numFrames){
+    
+    // start from scratch, the room should be empty for the next numFrames
+    std::fill(background.begin(), background.end(), 0);
+    std::fill(backgroundLimit.begin(), backgroundLimit.end(), USHRT_MAX);
+    std::fill(stillFrames.begin(), stillFrames.end(), 0);
+    learnFramesLeft = numFrames;
+    learned = false;
+    ofLogNotice("DepthSegmenter") << "learning background for " << numFrames << " frames";
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::clearBackground(){
+    
+    std::fill(background.begin(), background.end(), 0);
+    std::fill(backgroundLimit.begin(), backgroundLimit.end(), USHRT_MAX);
+    std::fill(stillFrames.begin(), stillFrames.end(), 0);
+    learnFramesLeft = 0;
+    learned = false;
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::clearBodies(){
+    bodies.clear();
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::addBody(const ofRectangle & bounds){
+    bodies.push_back(bounds);
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::markBodies(int w, int h, bool mirror){
+    
+    // the bounds come from the mask, which may be mirrored; the model is in kinect order
+    std::fill(bodyPixels.begin(), bodyPixels.end(), 0);
+    for(int i = 0; i < bodies.size(); i++){
+        const ofRectangle & r = bodies[i];
+        int x0 = mirror ? w - (r.x + r.width) : r.x;
+        int x1 = x0 + r.width;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, w);
+        int y0 = std::max((int) r.y, 0);
+        int y1 = std::min((int) (r.y + r.height), h);
+        for(int y = y0; y < y1 && x1 > x0; y++){
+            memset(&bodyPixels[y * w + x0], 1, x1 - x0);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool DepthSegmenter::isLearning(){
+    return learnFramesLeft > 0;
+}
+
+//--------------------------------------------------------------
+
+bool DepthSegmenter::hasBackground(){
+    return learned;
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::updateBackground(const unsigned short * src, int numPixels){
+    
+    unsigned short * bg = background.data();
+    
+    if(learnFramesLeft > 0){
+        
+        // the background is the furthest thing each pixel sees: anything passing through is
+        // in front of it, so a running max ignores people walking by while we learn.
+        // holes (0) never win a max, so they stay unknown until something real is seen.
+        for(int i = 0; i < numPixels; i++){
+            bg[i] = std::max(bg[i], src[i]);
+        }
+        
+        learnFramesLeft--;
+        if(learnFramesLeft == 0){
+            learned = true;
+            ofLogNotice("DepthSegmenter") << "background learned";
+        }
+        
+    } else {
+        
+        // pixels that already look like background follow slow changes. fixed point to keep
+        // it integer, rounded to nearest both ways so the model doesn't creep towards the sensor.
+        // something closer only becomes background after holding still for absorbFrames outside
+        // every tracked body, so a visitor standing still isn't absorbed but a chair put down is.
+        // pixels never seen while learning are only filled in from readings beyond the
+        // far plane, which can't be a visitor.
+        int rate = adaptRate * 256;
+        int far = farMM;
+        unsigned short * still = stillDepth.data();
+        unsigned short * frames = stillFrames.data();
+        const unsigned char * body = bodyPixels.data();
+        for(int i = 0; i < numPixels; i++){
+            int d = src[i];
+            int b = bg[i];
+            if(b == 0){
+                bg[i] = d > far ? d : 0;
+                continue;
+            }
+            if(d == 0) continue;
+            
+            if(d + tolerance(b) >= b){
+                int step = (d - b) * rate;
+                step = (step + (step >= 0 ? 128 : -128)) / 256;
+                bg[i] = b + step;
+                frames[i] = 0;
+                continue;
+            }
+            
+            // closer than the background: count how long it stays put
+            if(absorbFrames <= 0 || body[i] || abs(d - still[i]) > tolerance(d)){
+                still[i] = d;
+                frames[i] = 0;
+            } else if(++frames[i] >= absorbFrames){
+                bg[i] = d;
+                frames[i] = 0;
+            }
+        }
+    }
+    
+    updateLimits(numPixels);
+}
+
+//--------------------------------------------------------------
+
+void DepthSegmenter::updateLimits(int numPixels){
+    
+    // the same depth scaled tolerance the adaptation uses.
+    // unknown pixels get USHRT_MAX so they never reject anything.
+    const unsigned short * bg = background.data();
+    unsigned short * limit = backgroundLimit.data();
+    
+    for(int i = 0; i < numPixels; i++){
+        int b = bg[i];
+        int l = b - tolerance(b);
+        limit[i] = b == 0 ? USHRT_MAX : std::max(l, 0);
+    }
+}
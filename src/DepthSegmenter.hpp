@@ -0,0 +1,75 @@
+//
+//  DepthSegmenter.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Segments the body straight from the kinect's raw 16 bit depth (millimetres),
+// skipping the 8 bit range-compressed depth image completely.
+// An optional background model (furthest stable depth per pixel, learned while the space is empty)
+// removes furniture, walls and floor that sit inside the near/far band. Once learned it follows slow
+// changes further away, and takes in things that were brought closer (a chair put down) once they
+// have held still for a while outside every tracked body.
+
+#pragma once
+
+#ifndef DepthSegmenter_hpp
+#define DepthSegmenter_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* DepthSegmenter_hpp */
+
+
+class DepthSegmenter{
+    
+public:
+    DepthSegmenter();
+    
+    void setRange(int _nearMM, int _farMM);
+    
+    // writes a 0/255 mask of every pixel between nearMM and farMM into dst.
+    // dstStride is in bytes, so an IplImage's imageData/widthStep can be used directly.
+    void segment(const ofShortPixels & raw, unsigned char * dst, int dstStride, bool mirror);
+    
+    // background model
+    void learnBackground(int numFrames);
+    void clearBackground();
+    bool isLearning();
+    bool hasBackground();
+    
+    // tracked bodies' bounds in the mask's coordinates, never absorbed however still they stand.
+    // set before each segment.
+    void clearBodies();
+    void addBody(const ofRectangle & bounds);
+    
+    int nearMM;
+    int farMM;
+    
+    bool useBackground;
+    int toleranceMM;        // minimum distance in front of the background to count as foreground
+    float adaptRate;        // how fast background pixels follow slow changes once learned (0 = frozen)
+    int absorbFrames;       // how long something closer has to hold still before it's background (0 = never)
+    
+private:
+    void updateBackground(const unsigned short * src, int numPixels);
+    void updateLimits(int numPixels);
+    void markBodies(int w, int h, bool mirror);
+    
+    // kinect depth noise grows with distance, so the tolerance does too (roughly 2% of the depth)
+    inline int tolerance(int depth){ return toleranceMM + (depth >> 6) + (depth >> 7); }
+    
+    // background depth in mm (0 = never seen), and the depth a pixel has to beat to be foreground.
+    // kept in kinect (unmirrored) order so they can be read in the same pass as the raw depth.
+    vector<unsigned short> background;
+    vector<unsigned short> backgroundLimit;
+    vector<unsigned short> stillDepth;      // closer reading each pixel is holding, and for how many frames
+    vector<unsigned short> stillFrames;
+    vector<unsigned char> bodyPixels;       // 1 inside a tracked body's bounds, kinect order
+    vector<ofRectangle> bodies;
+    int learnFramesLeft;
+    bool learned;
+    
+};
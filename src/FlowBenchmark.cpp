@@ -0,0 +1,189 @@
+//
+//  FlowBenchmark.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FlowBenchmark.hpp"
+
+//--------------------------------------------------------------
+
+FlowBenchmark::FlowBenchmark(){
+    recording = false;
+    recordedFrames = 0;
+}
+
+//--------------------------------------------------------------
+
+void FlowBenchmark::startRecording(){
+    
+    recordDir = "sessions/" + ofGetTimestampString("%Y%m%d-%H%M%S");
+    ofDirectory::createDirectory(recordDir, true, true);
+    recordedFrames = 0;
+    recording = true;
+    ofLogNotice("FlowBenchmark") << "recording flow session to " << recordDir;
+}
+
+//--------------------------------------------------------------
+
+void FlowBenchmark::stopRecording(){
+    
+    if(!recording) return;
+    recording = false;
+    ofLogNotice("FlowBenchmark") << "recorded " << recordedFrames << " frames";
+}
+
+//--------------------------------------------------------------
+
+bool FlowBenchmark::isRecording(){
+    return recording;
+}
+
+//--------------------------------------------------------------
+
+void FlowBenchmark::recordFrame(const cv::Mat & gray, const vector<cv::Point2f> & points){
+    
+    if(!recording) return;
+    
+    // one png per frame plus a text file of the body points (recording is a debug tool, it can allocate)
+    char name[32];
+    sprintf(name, "/frame_%05d", recordedFrames);
+    string base = recordDir + name;
+    
+    ofPixels pixels;
+    pixels.setFromPixels(gray.data, gray.cols, gray.rows, OF_PIXELS_GRAY);
+    ofSaveImage(pixels, base + ".png");
+    
+    ofstream file(ofToDataPath(base + ".txt").c_str());
+    for(int i = 0; i < points.size(); i++){
+        file << points[i].x << " " << points[i].y << "\n";
+    }
+    
+    recordedFrames++;
+}
+
+//--------------------------------------------------------------
+
+void FlowBenchmark::run(string sessionDir){
+    
+    if(sessionDir.empty()) sessionDir = recordDir;
+    if(sessionDir.empty() || !loadSession(sessionDir)){
+        ofLogError("FlowBenchmark") << "no recorded session to run";
+        return;
+    }
+    
+    FarnebackFlowEngine farneback;
+    DisFlowEngine dis;
+    SparseLKFlowEngine sparseLK;
+    FlowEngine * engines[] = { &farneback, &dis, &sparseLK };
+    
+    vector<Result> results;
+    for(int i = 0; i < 3; i++){
+        if(!engines[i]->isAvailable()){
+            ofLogNotice("FlowBenchmark") << engines[i]->getName() << ": not available in this OpenCV build";
+            continue;
+        }
+        results.push_back(runEngine(*engines[i]));
+    }
+    
+    // summary to the log, full numbers to json
+    ofstream json(ofToDataPath(sessionDir + "/benchmark.json").c_str());
+    json << "{\n  \"session\": \"" << sessionDir << "\",\n  \"frames\": " << frames.size() << ",\n  \"engines\": [\n";
+    for(int i = 0; i < results.size(); i++){
+        const Result & r = results[i];
+        ofLogNotice("FlowBenchmark") << r.name << ": " << r.meanMillis << "ms mean, " << r.p95Millis << "ms p95, warp error "
+        << r.warpError << " (no flow " << r.rawError << ")";
+        
+        json << "    { \"name\": \"" << r.name << "\", \"meanMs\": " << r.meanMillis << ", \"p95Ms\": " << r.p95Millis
+        << ", \"warpError\": " << r.warpError << ", \"rawError\": " << r.rawError << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+}
+
+//--------------------------------------------------------------
+
+bool FlowBenchmark::loadSession(const string & dir){
+    
+    frames.clear();
+    framePoints.clear();
+    
+    for(int i = 0; ; i++){
+        char name[32];
+        sprintf(name, "/frame_%05d", i);
+        string base = dir + name;
+        
+        ofPixels pixels;
+        if(!ofFile::doesFileExist(base + ".png") || !ofLoadImage(pixels, base + ".png")) break;
+        
+        cv::Mat frame(pixels.getHeight(), pixels.getWidth(), CV_8UC1, pixels.getData());
+        frames.push_back(frame.clone());
+        
+        vector<cv::Point2f> points;
+        ifstream file(ofToDataPath(base + ".txt").c_str());
+        float x, y;
+        while(file >> x >> y){
+            points.push_back(cv::Point2f(x, y));
+        }
+        framePoints.push_back(points);
+    }
+    
+    ofLogNotice("FlowBenchmark") << "loaded " << frames.size() << " frames from " << dir;
+    return frames.size() > 1;
+}
+
+//--------------------------------------------------------------
+
+FlowBenchmark::Result FlowBenchmark::runEngine(FlowEngine & engine){
+    
+    Result result;
+    result.name = engine.getName();
+    
+    cv::Mat flow(frames[0].size(), CV_32FC2, cv::Scalar::all(0));
+    vector<float> millis;
+    double warpSum = 0;
+    double rawSum = 0;
+    
+    // same order as the live stage: current frame first, previous second, warm after the first frame
+    for(int i = 1; i < frames.size(); i++){
+        engine.setTrackPoints(framePoints[i]);
+        
+        uint64_t start = ofGetElapsedTimeMicros();
+        engine.calc(frames[i], frames[i - 1], flow, i > 1);
+        millis.push_back((ofGetElapsedTimeMicros() - start) * 0.001);
+        
+        warpSum += warpError(frames[i], frames[i - 1], flow);
+        rawSum += cv::norm(frames[i], frames[i - 1], cv::NORM_L1) / frames[i].total();
+    }
+    
+    std::sort(millis.begin(), millis.end());
+    float sum = 0;
+    for(int i = 0; i < millis.size(); i++) sum += millis[i];
+    
+    result.meanMillis = sum / millis.size();
+    result.p95Millis = millis[min((int) millis.size() - 1, (int) (millis.size() * 0.95))];
+    result.warpError = warpSum / millis.size();
+    result.rawError = rawSum / millis.size();
+    return result;
+}
+
+//--------------------------------------------------------------
+
+float FlowBenchmark::warpError(const cv::Mat & from, const cv::Mat & to, const cv::Mat & flow){
+    
+    // pull 'to' back along the flow, then compare with 'from'
+    mapX.create(flow.size(), CV_32FC1);
+    mapY.create(flow.size(), CV_32FC1);
+    for(int y = 0; y < flow.rows; y++){
+        const float * f = flow.ptr<float>(y);
+        float * mx = mapX.ptr<float>(y);
+        float * my = mapY.ptr<float>(y);
+        for(int x = 0; x < flow.cols; x++){
+            mx[x] = x + f[x * 2];
+            my[x] = y + f[x * 2 + 1];
+        }
+    }
+    
+    cv::remap(to, warped, mapX, mapY, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    return cv::norm(from, warped, cv::NORM_L1) / from.total();
+}
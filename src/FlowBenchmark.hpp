@@ -0,0 +1,62 @@
+//
+//  FlowBenchmark.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Records the decimated grey frames (and body points) FlowStage sees, then replays a recorded
+// session through every available FlowEngine offline, reporting cost and quality.
+// Quality is the photometric error after warping one frame onto the other with the computed flow
+// (lower is better), next to the error with no flow at all as a baseline.
+// Sessions live in bin/data/sessions/<timestamp>/.
+
+#pragma once
+
+#ifndef FlowBenchmark_hpp
+#define FlowBenchmark_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FlowEngine.hpp"
+
+#endif /* FlowBenchmark_hpp */
+
+
+class FlowBenchmark{
+    
+public:
+    FlowBenchmark();
+    
+    void startRecording();
+    void stopRecording();
+    bool isRecording();
+    void recordFrame(const cv::Mat & gray, const vector<cv::Point2f> & points);
+    
+    // runs every engine over the session, logs a summary and writes benchmark.json next to the frames.
+    // with an empty path the last recorded session is used.
+    void run(string sessionDir = "");
+    
+private:
+    struct Result{
+        string name;
+        float meanMillis;
+        float p95Millis;
+        float warpError;
+        float rawError;
+    };
+    
+    bool loadSession(const string & dir);
+    Result runEngine(FlowEngine & engine);
+    float warpError(const cv::Mat & from, const cv::Mat & to, const cv::Mat & flow);
+    
+    bool recording;
+    string recordDir;
+    int recordedFrames;
+    
+    vector<cv::Mat> frames;
+    vector<vector<cv::Point2f> > framePoints;
+    cv::Mat mapX, mapY, warped;
+    
+};
@@ -0,0 +1,86 @@
+//
+//  FlowEngine.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FlowEngine.hpp"
+
+//--------------------------------------------------------------
+
+void FarnebackFlowEngine::calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm){
+    
+    //Computing optical flow (visit https://goo.gl/jm1Vfr for explanation of parameters)
+    int flags = warm ? cv::OPTFLOW_USE_INITIAL_FLOW : 0;
+    cv::calcOpticalFlowFarneback(from, to, flow, 0.7, 3, 11, 5, 5, 1.1, flags);
+}
+
+//--------------------------------------------------------------
+
+bool DisFlowEngine::isAvailable(){
+#ifdef FLOW_ENGINE_HAS_DIS
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+
+void DisFlowEngine::calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm){
+    
+#ifdef FLOW_ENGINE_HAS_DIS
+    if(dis.empty()){
+        dis = cv::DISOpticalFlow::create(cv::DISOpticalFlow::PRESET_ULTRAFAST);
+    }
+    
+    // DIS uses whatever is in flow as its initial guess when it's the right size and type,
+    // so a cold start has to clear it
+    if(!warm) flow.setTo(cv::Scalar::all(0));
+    dis->calc(from, to, flow);
+#else
+    flow.setTo(cv::Scalar::all(0));
+#endif
+}
+
+//--------------------------------------------------------------
+
+SparseLKFlowEngine::SparseLKFlowEngine(){
+    splatRadius = 2;
+}
+
+//--------------------------------------------------------------
+
+void SparseLKFlowEngine::setTrackPoints(const vector<cv::Point2f> & _points){
+    points = _points;
+}
+
+//--------------------------------------------------------------
+
+void SparseLKFlowEngine::calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm){
+    
+    flow.setTo(cv::Scalar::all(0));
+    if(points.empty()) return;
+    
+    // only the body's outline is tracked, which is all the sim looks at anyway
+    cv::calcOpticalFlowPyrLK(from, to, points, found, status, error, cv::Size(15, 15), 2);
+    
+    // splat each vector into a small block so the field looks dense around the outline
+    for(int i = 0; i < points.size(); i++){
+        if(!status[i]) continue;
+        
+        float fx = found[i].x - points[i].x;
+        float fy = found[i].y - points[i].y;
+        int cx = points[i].x;
+        int cy = points[i].y;
+        
+        for(int y = max(cy - splatRadius, 0); y <= min(cy + splatRadius, flow.rows - 1); y++){
+            float * row = flow.ptr<float>(y);
+            for(int x = max(cx - splatRadius, 0); x <= min(cx + splatRadius, flow.cols - 1); x++){
+                row[x * 2] = fx;
+                row[x * 2 + 1] = fy;
+            }
+        }
+    }
+}
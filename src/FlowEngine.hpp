@@ -0,0 +1,90 @@
+//
+//  FlowEngine.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Interchangeable optical flow algorithms behind FlowStage. Every engine fills a dense CV_32FC2
+// field (sparse ones splat their vectors into it) so everything downstream stays the same.
+//
+//  - Farneback: dense, what we've always used
+//  - DIS: dense, OpenCV's ultrafast preset - needs OpenCV 3.4.1 or newer (3.4.0 only has it in contrib)
+//  - Sparse LK: pyramidal Lucas-Kanade on the body's contour points only
+
+#pragma once
+
+#ifndef FlowEngine_hpp
+#define FlowEngine_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && (CV_MINOR_VERSION > 4 || (CV_MINOR_VERSION == 4 && CV_VERSION_REVISION >= 1)))
+#define FLOW_ENGINE_HAS_DIS
+#endif
+
+#endif /* FlowEngine_hpp */
+
+
+class FlowEngine{
+    
+public:
+    virtual ~FlowEngine(){}
+    
+    virtual string getName() = 0;
+    virtual bool isAvailable(){ return true; }
+    
+    // flow from 'from' to 'to', written into flow (same size, CV_32FC2, may be a view).
+    // with warm set, flow already holds last frame's answer and can be used as a starting point.
+    virtual void calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm) = 0;
+    
+    // points worth tracking, in the same coordinates as 'from' (only the sparse engine cares)
+    virtual void setTrackPoints(const vector<cv::Point2f> & points){}
+    
+};
+
+
+class FarnebackFlowEngine : public FlowEngine{
+    
+public:
+    string getName(){ return "farneback"; }
+    void calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm);
+    
+};
+
+
+class DisFlowEngine : public FlowEngine{
+    
+public:
+    string getName(){ return "dis"; }
+    bool isAvailable();
+    void calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm);
+    
+private:
+#ifdef FLOW_ENGINE_HAS_DIS
+    cv::Ptr<cv::DISOpticalFlow> dis;
+#endif
+    
+};
+
+
+class SparseLKFlowEngine : public FlowEngine{
+    
+public:
+    SparseLKFlowEngine();
+    
+    string getName(){ return "sparse lk"; }
+    void calc(const cv::Mat & from, const cv::Mat & to, cv::Mat & flow, bool warm);
+    void setTrackPoints(const vector<cv::Point2f> & points);
+    
+    int splatRadius;    // each tracked vector is written into a (2r+1)^2 block of the field
+    
+private:
+    vector<cv::Point2f> points;
+    vector<cv::Point2f> found;
+    vector<unsigned char> status;
+    vector<float> error;
+    
+};
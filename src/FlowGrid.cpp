@@ -0,0 +1,31 @@
+//
+//  FlowGrid.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FlowGrid.hpp"
+
+//--------------------------------------------------------------
+
+FlowGrid::FlowGrid(){
+    clear();
+    setScreenRect(ofRectangle(0, 0, 640, 480));
+}
+
+//--------------------------------------------------------------
+
+void FlowGrid::clear(){
+    memset(data, 0, sizeof(data));
+}
+
+//--------------------------------------------------------------
+
+void FlowGrid::setScreenRect(const ofRectangle & rect){
+    
+    left = rect.x;
+    top = rect.y;
+    toGridX = rect.width > 0 ? cols / rect.width : 0;
+    toGridY = rect.height > 0 ? rows / rect.height : 0;
+}
@@ -0,0 +1,79 @@
+//
+//  FlowGrid.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Coarse, smoothed copy of the optical flow field, laid out in screen orientation, that every
+// particle can sample at its own position. 40 x 30 cells of two floats is under 10KB, so it
+// stays in cache while the whole particle system reads from it.
+
+#pragma once
+
+#ifndef FlowGrid_hpp
+#define FlowGrid_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* FlowGrid_hpp */
+
+
+struct FlowGrid{
+    
+    static const int cols = 40;
+    static const int rows = 30;
+    
+    FlowGrid();
+    
+    void clear();
+    
+    // screen area the grid covers. outside it the flow fades to zero over one cell, so a hand only
+    // moves the particles near it, not everything between the body's rect and the screen edge.
+    void setScreenRect(const ofRectangle & rect);
+    
+    // bilinear lookup of the flow at a screen position
+    inline void sample(float px, float py, float & fx, float & fy) const {
+        
+        float gx = (px - left) * toGridX - 0.5f;
+        float gy = (py - top) * toGridY - 0.5f;
+        
+        // cells outside the rect, the rect's edges sit half a cell beyond the outer centres
+        float outX = gx < -0.5f ? -0.5f - gx : (gx > cols - 0.5f ? gx - (cols - 0.5f) : 0);
+        float outY = gy < -0.5f ? -0.5f - gy : (gy > rows - 0.5f ? gy - (rows - 0.5f) : 0);
+        float fade = 1 - (outX > outY ? outX : outY);
+        if(fade <= 0){
+            fx = fy = 0;
+            return;
+        }
+        
+        gx = gx < 0 ? 0 : (gx > cols - 1 ? cols - 1 : gx);
+        gy = gy < 0 ? 0 : (gy > rows - 1 ? rows - 1 : gy);
+        
+        int x0 = (int) gx;
+        int y0 = (int) gy;
+        int x1 = x0 + 1 < cols ? x0 + 1 : x0;
+        int y1 = y0 + 1 < rows ? y0 + 1 : y0;
+        float tx = gx - x0;
+        float ty = gy - y0;
+        
+        const float * a = data + (y0 * cols + x0) * 2;
+        const float * b = data + (y0 * cols + x1) * 2;
+        const float * c = data + (y1 * cols + x0) * 2;
+        const float * d = data + (y1 * cols + x1) * 2;
+        
+        float topX = a[0] + (b[0] - a[0]) * tx;
+        float topY = a[1] + (b[1] - a[1]) * tx;
+        float bottomX = c[0] + (d[0] - c[0]) * tx;
+        float bottomY = c[1] + (d[1] - c[1]) * tx;
+        fx = (topX + (bottomX - topX) * ty) * fade;
+        fy = (topY + (bottomY - topY) * ty) * fade;
+    }
+    
+    float data[rows * cols * 2];    // interleaved x, y
+    
+    float left, top;
+    float toGridX, toGridY;
+    
+};
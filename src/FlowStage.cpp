@@ -0,0 +1,387 @@
+//
+//  FlowStage.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FlowStage.hpp"
+
+float FlowStats::maxMagnitude = 16;
+
+//--------------------------------------------------------------
+
+FlowStage::FlowStage(){
+    
+    decimate = 0.25;        //Decimate images to 25% (makes calculations faster + works like a blurr too)
+    warmStart = true;
+    current = 0;
+    framesSeen = 0;
+    flowValid = false;
+    srcWidth = 0;
+    computeMillis = 0;
+    
+    engines.push_back(&farneback);
+    engines.push_back(&dis);
+    engines.push_back(&sparseLK);
+    engineIndex = 0;
+    
+    useMask = false;
+    hasMask = false;
+    movingThreshold = 1;
+    mirrorGrid = true;
+    memset(&stats, 0, sizeof(stats));
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::setup(int _srcWidth, int srcHeight, float _decimate){
+    
+    decimate = _decimate;
+    srcWidth = _srcWidth;
+    int w = _srcWidth * decimate;
+    int h = srcHeight * decimate;
+    
+    // everything allocated once, here
+    gray[0].create(h, w, CV_8UC1);
+    gray[1].create(h, w, CV_8UC1);
+    flow.create(h, w, CV_32FC2);
+    flow.setTo(cv::Scalar::all(0));
+    maskSmall.create(h, w, CV_8UC1);
+    maskScaled.create(h, w, CV_8UC1);
+    gridSmall.create(FlowGrid::rows, FlowGrid::cols, CV_32FC2);
+    gridSmooth.create(FlowGrid::rows, FlowGrid::cols, CV_32FC2);
+    gridCount.create(FlowGrid::rows, FlowGrid::cols, CV_32FC1);
+    grid.clear();
+    
+    current = 0;
+    framesSeen = 0;
+    flowValid = false;
+    lastRoi = cv::Rect(0, 0, w, h);
+}
+
+//--------------------------------------------------------------
+
+bool FlowStage::update(const cv::Mat & luminance, const ofRectangle & roi){
+    
+    // flip the ping-pong: last frame's grey becomes 'previous' without touching its pixels
+    current = 1 - current;
+    if(luminance.size() == gray[current].size()) luminance.copyTo(gray[current]);
+    else cv::resize(luminance, gray[current], gray[current].size(), 0, 0, cv::INTER_AREA);
+    framesSeen++;
+    
+    if(framesSeen < 2) return false;
+    
+    cv::Rect r(roi.x, roi.y, roi.width, roi.height);
+    r &= cv::Rect(0, 0, flow.cols, flow.rows);
+    if(r.width < 16 || r.height < 16) r = cv::Rect(0, 0, flow.cols, flow.rows);
+    
+    // the sparse engine wants its points relative to the roi
+    trackPointsInRoi.clear();
+    for(int i = 0; i < trackPoints.size(); i++){
+        cv::Point2f p(trackPoints[i].x - r.x, trackPoints[i].y - r.y);
+        if(p.x >= 0 && p.y >= 0 && p.x < r.width && p.y < r.height) trackPointsInRoi.push_back(p);
+    }
+    
+    // the engine writes straight into this view of the persistent field. Warm starting only makes
+    // sense when last frame's field is there to start from.
+    FlowEngine * engine = engines[engineIndex];
+    engine->setTrackPoints(trackPointsInRoi);
+    cv::Mat flowInRoi = flow(r);
+    
+    //(current frame first, previous second - the sign the particles were tuned with)
+    uint64_t start = ofGetElapsedTimeMicros();
+    engine->calc(gray[current](r), gray[1 - current](r), flowInRoi, warmStart && flowValid);
+    uint64_t end = ofGetElapsedTimeMicros();
+    Profiler::record(PROFILE_FLOW, start, end);
+    float millis = (end - start) * 0.001;
+    computeMillis = computeMillis * 0.9 + millis * 0.1;
+    
+    // anything outside the roi is stale, zero it (only the strips that were inside last time)
+    clearOutside(r);
+    lastRoi = r;
+    flowValid = true;
+    
+    ProfileScope scope(PROFILE_FLOW_STATS);
+    computeStats(r);
+    buildGrid();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::setMask(const cv::Mat & mask, bool mirror){
+    
+    // nearest neighbour keeps it binary, then flip into the colour image's orientation
+    const cv::Mat * src = &mask;
+    if(mask.size() != maskScaled.size()){
+        cv::resize(mask, maskScaled, maskScaled.size(), 0, 0, cv::INTER_NEAREST);
+        src = &maskScaled;
+    }
+    if(mirror) cv::flip(*src, maskSmall, 1);
+    else src->copyTo(maskSmall);
+    hasMask = true;
+}
+
+//--------------------------------------------------------------
+
+const FlowStats & FlowStage::getStats(){
+    return stats;
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::computeStats(const cv::Rect & r){
+    
+    // the whole roi (everything outside it is zero anyway) in one pass per row.
+    // sums use a 0/1 weight instead of a branch so the inner loop vectorises;
+    // the histograms need a scatter so they get their own loop over moving pixels.
+    bool masked = useMask && hasMask;
+    float sumX = 0, sumY = 0, numMoving = 0;
+    
+    memset(stats.magnitudeHistogram, 0, sizeof(stats.magnitudeHistogram));
+    memset(stats.directionHistogram, 0, sizeof(stats.directionHistogram));
+    memset(medianBinsX, 0, sizeof(medianBinsX));
+    memset(medianBinsY, 0, sizeof(medianBinsY));
+    
+    float magnitudeScale = FlowStats::numMagnitudeBins / FlowStats::maxMagnitude;
+    float directionScale = FlowStats::numDirectionBins / TWO_PI;
+    
+    for(int y = r.y; y < r.y + r.height; y++){
+        const float * f = flow.ptr<float>(y) + r.x * 2;
+        const unsigned char * m = maskSmall.ptr<unsigned char>(y) + r.x;
+        
+        float rowX = 0, rowY = 0, rowMoving = 0;
+        for(int x = 0; x < r.width; x++){
+            float fx = f[x * 2];
+            float fy = f[x * 2 + 1];
+            float w = (fabsf(fx) + fabsf(fy) > movingThreshold) ? 1 : 0;
+            if(masked) w = m[x] ? w : 0;
+            rowX += fx * w;
+            rowY += fy * w;
+            rowMoving += w;
+        }
+        sumX += rowX;
+        sumY += rowY;
+        numMoving += rowMoving;
+        
+        if(rowMoving == 0) continue;
+        
+        for(int x = 0; x < r.width; x++){
+            float fx = f[x * 2];
+            float fy = f[x * 2 + 1];
+            if(fabsf(fx) + fabsf(fy) <= movingThreshold || (masked && !m[x])) continue;
+            
+            float magnitude = sqrtf(fx * fx + fy * fy);
+            int bin = min(int(magnitude * magnitudeScale), FlowStats::numMagnitudeBins - 1);
+            stats.magnitudeHistogram[bin]++;
+            
+            float angle = atan2f(fy, fx);
+            if(angle < 0) angle += TWO_PI;
+            int direction = int(angle * directionScale + 0.5) % FlowStats::numDirectionBins;
+            stats.directionHistogram[direction] += magnitude;
+            
+            medianBinsX[(int) ofClamp(fx * 4 + 80.5, 0, numMedianBins - 1)]++;
+            medianBinsY[(int) ofClamp(fy * 4 + 80.5, 0, numMedianBins - 1)]++;
+        }
+    }
+    
+    int n = numMoving;
+    stats.numMoving = n;
+    stats.movingFraction = r.area() > 0 ? numMoving / r.area() : 0;
+    stats.meanX = n > 0 ? sumX / n : 0;
+    stats.meanY = n > 0 ? sumY / n : 0;
+    stats.medianX = histogramMedian(medianBinsX, n);
+    stats.medianY = histogramMedian(medianBinsY, n);
+    
+    // strongest direction
+    int best = 0;
+    float total = 0;
+    for(int i = 0; i < FlowStats::numDirectionBins; i++){
+        total += stats.directionHistogram[i];
+        if(stats.directionHistogram[i] > stats.directionHistogram[best]) best = i;
+    }
+    stats.dominantDirection = best / directionScale;
+    stats.dominantStrength = total > 0 ? stats.directionHistogram[best] / total : 0;
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::buildGrid(){
+    
+    // each cell averages only its moving pixels, like the global mean the particles were
+    // tuned on, so local forces have the same strength; cells with no motion stay zero.
+    // with the mask on only the body's pixels count, as in the stats.
+    // the blur spreads a hand's motion over its neighbours.
+    // values keep the sign convention of the global mean, only the cells are mirrored.
+    gridSmall.setTo(cv::Scalar::all(0));
+    gridCount.setTo(cv::Scalar::all(0));
+    bool masked = useMask && hasMask;
+    for(int y = 0; y < flow.rows; y++){
+        const float * f = flow.ptr<float>(y);
+        const unsigned char * m = maskSmall.ptr<unsigned char>(y);
+        cv::Vec2f * cell = gridSmall.ptr<cv::Vec2f>(y * FlowGrid::rows / flow.rows);
+        float * count = gridCount.ptr<float>(y * FlowGrid::rows / flow.rows);
+        for(int x = 0; x < flow.cols; x++){
+            float fx = f[x * 2];
+            float fy = f[x * 2 + 1];
+            if(fabsf(fx) + fabsf(fy) <= movingThreshold || (masked && !m[x])) continue;
+            int c = x * FlowGrid::cols / flow.cols;
+            cell[c][0] += fx;
+            cell[c][1] += fy;
+            count[c]++;
+        }
+    }
+    for(int y = 0; y < FlowGrid::rows; y++){
+        cv::Vec2f * cell = gridSmall.ptr<cv::Vec2f>(y);
+        const float * count = gridCount.ptr<float>(y);
+        for(int x = 0; x < FlowGrid::cols; x++){
+            if(count[x] == 0) continue;
+            cell[x][0] /= count[x];
+            cell[x][1] /= count[x];
+        }
+    }
+    cv::GaussianBlur(gridSmall, gridSmooth, cv::Size(3, 3), 0);
+    if(mirrorGrid) cv::flip(gridSmooth, gridSmall, 1);
+    else gridSmooth.copyTo(gridSmall);
+    
+    for(int y = 0; y < FlowGrid::rows; y++){
+        memcpy(grid.data + y * FlowGrid::cols * 2, gridSmall.ptr<float>(y), FlowGrid::cols * 2 * sizeof(float));
+    }
+}
+
+//--------------------------------------------------------------
+
+const FlowGrid & FlowStage::getGrid(){
+    return grid;
+}
+
+//--------------------------------------------------------------
+
+float FlowStage::histogramMedian(const int * bins, int count){
+    
+    if(count == 0) return 0;
+    
+    int half = (count + 1) / 2;
+    int seen = 0;
+    for(int i = 0; i < numMedianBins; i++){
+        seen += bins[i];
+        if(seen >= half) return (i - 80) * 0.25;
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::clearOutside(const cv::Rect & r){
+    
+    if(r == lastRoi) return;
+    
+    // zero the four strips around r, in place
+    if(r.y > 0) flow(cv::Rect(0, 0, flow.cols, r.y)).setTo(cv::Scalar::all(0));
+    if(r.y + r.height < flow.rows) flow(cv::Rect(0, r.y + r.height, flow.cols, flow.rows - r.y - r.height)).setTo(cv::Scalar::all(0));
+    if(r.x > 0) flow(cv::Rect(0, r.y, r.x, r.height)).setTo(cv::Scalar::all(0));
+    if(r.x + r.width < flow.cols) flow(cv::Rect(r.x + r.width, r.y, flow.cols - r.x - r.width, r.height)).setTo(cv::Scalar::all(0));
+}
+
+//--------------------------------------------------------------
+
+bool FlowStage::hasFlow(){
+    return flowValid;
+}
+
+//--------------------------------------------------------------
+
+const cv::Mat & FlowStage::getFlow(){
+    return flow;
+}
+
+//--------------------------------------------------------------
+
+ofRectangle FlowStage::getRoi(){
+    return ofRectangle(lastRoi.x, lastRoi.y, lastRoi.width, lastRoi.height);
+}
+
+//--------------------------------------------------------------
+
+int FlowStage::getWidth(){
+    return flow.cols;
+}
+
+//--------------------------------------------------------------
+
+int FlowStage::getHeight(){
+    return flow.rows;
+}
+
+//--------------------------------------------------------------
+
+int FlowStage::getNumEngines(){
+    return engines.size();
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::setEngine(int index){
+    
+    index = ofClamp(index, 0, engines.size() - 1);
+    if(!engines[index]->isAvailable()){
+        ofLogWarning("FlowStage") << engines[index]->getName() << " isn't available in this OpenCV build";
+        return;
+    }
+    
+    // a different engine's field is no use as a warm start
+    engineIndex = index;
+    flowValid = false;
+    computeMillis = 0;
+    ofLogNotice("FlowStage") << "optical flow engine: " << getEngineName();
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::nextEngine(){
+    
+    for(int i = 1; i <= engines.size(); i++){
+        int index = (engineIndex + i) % engines.size();
+        if(engines[index]->isAvailable()){
+            setEngine(index);
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+string FlowStage::getEngineName(){
+    return engines[engineIndex]->getName();
+}
+
+//--------------------------------------------------------------
+
+void FlowStage::setTrackPoints(const vector<ofPoint> & maskPoints, bool mirror){
+    
+    // mask pixels -> decimated colour pixels (the mask is mirrored, the colour image isn't)
+    trackPoints.resize(maskPoints.size());
+    for(int i = 0; i < maskPoints.size(); i++){
+        float x = mirror ? srcWidth - 1 - maskPoints[i].x : maskPoints[i].x;
+        trackPoints[i] = cv::Point2f(x * decimate, maskPoints[i].y * decimate);
+    }
+}
+
+//--------------------------------------------------------------
+
+const vector<cv::Point2f> & FlowStage::getTrackPoints(){
+    return trackPoints;
+}
+
+//--------------------------------------------------------------
+
+const cv::Mat & FlowStage::getGray(){
+    return gray[current];
+}
+
+//--------------------------------------------------------------
+
+float FlowStage::getComputeMillis(){
+    return computeMillis;
+}
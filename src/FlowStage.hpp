@@ -0,0 +1,109 @@
+//
+//  FlowStage.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Dense optical flow between consecutive kinect colour frames, at a decimated resolution.
+// Owns all of its buffers: the decimated luminance comes from the frame pyramid, the two grey
+// frames are ping-ponged by index instead of copied, and the flow field is kept between frames so Farneback
+// can start from last frame's answer.
+// The algorithm itself is a FlowEngine and can be switched at runtime.
+
+#pragma once
+
+#ifndef FlowStage_hpp
+#define FlowStage_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FlowEngine.hpp"
+#include "FlowGrid.hpp"
+#include "FlowStats.hpp"
+#include "Profiler.hpp"
+
+#endif /* FlowStage_hpp */
+
+
+class FlowStage{
+    
+public:
+    FlowStage();
+    
+    void setup(int srcWidth, int srcHeight, float _decimate);
+    
+    // call with every new kinect frame's luminance, already at the decimated size.
+    // roi is in decimated pixels (everything outside it is zero). returns true when a new flow field was computed.
+    bool update(const cv::Mat & luminance, const ofRectangle & roi);
+    
+    bool hasFlow();
+    const cv::Mat & getFlow();      // CV_32FC2, decimated size
+    ofRectangle getRoi();           // region the last field was computed in
+    int getWidth();
+    int getHeight();
+    
+    // engines
+    int getNumEngines();
+    void setEngine(int index);      // unavailable engines are skipped
+    void nextEngine();
+    string getEngineName();
+    
+    // body contour points in source (mask) pixels, for the sparse engine
+    void setTrackPoints(const vector<ofPoint> & maskPoints, bool mirror);
+    const vector<cv::Point2f> & getTrackPoints();
+    
+    // optional: only count flow inside the body mask (ideally the decimated pyramid level, other sizes get scaled here)
+    void setMask(const cv::Mat & mask, bool mirror);
+    const FlowStats & getStats();
+    
+    // coarse smoothed field in screen orientation, rebuilt with every new field
+    const FlowGrid & getGrid();
+    
+    const cv::Mat & getGray();      // this frame's decimated grey image
+    float getComputeMillis();       // smoothed cost of the flow calculation
+    
+    float decimate;
+    bool warmStart;                 // start from the previous field where the engine supports it
+    bool useMask;
+    float movingThreshold;
+    bool mirrorGrid;                // the screen is mirrored relative to the colour image
+    
+private:
+    void clearOutside(const cv::Rect & r);
+    void computeStats(const cv::Rect & r);
+    float histogramMedian(const int * bins, int count);
+    void buildGrid();
+    
+    FlowGrid grid;
+    cv::Mat gridSmall, gridSmooth;          // CV_32FC2, FlowGrid::cols x rows
+    cv::Mat gridCount;                      // moving pixels per cell
+    
+    FlowStats stats;
+    cv::Mat maskSmall, maskScaled;          // decimated body mask, same orientation as the flow
+    bool hasMask;
+    static const int numMedianBins = 161;   // -20 .. 20 pixels in quarter pixel steps
+    int medianBinsX[numMedianBins];
+    int medianBinsY[numMedianBins];
+    
+    FarnebackFlowEngine farneback;
+    DisFlowEngine dis;
+    SparseLKFlowEngine sparseLK;
+    vector<FlowEngine *> engines;
+    int engineIndex;
+    
+    int srcWidth;
+    vector<cv::Point2f> trackPoints;        // decimated, full frame
+    vector<cv::Point2f> trackPointsInRoi;
+    float computeMillis;
+    
+    cv::Mat gray[2];                // ping-pong: gray[current] is this frame
+    int current;
+    int framesSeen;
+    
+    cv::Mat flow;
+    bool flowValid;
+    cv::Rect lastRoi;
+    
+};
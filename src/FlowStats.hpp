@@ -0,0 +1,39 @@
+//
+//  FlowStats.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Kept apart from FlowStage so code that only reads the numbers (gestures, the particle
+// benchmark) doesn't need OpenCV.
+
+#pragma once
+
+#ifndef FlowStats_hpp
+#define FlowStats_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* FlowStats_hpp */
+
+
+// Summary of the flow field, computed once per new field. Only 'moving' pixels count
+// (|x| + |y| > movingThreshold), the same rule the old average used.
+struct FlowStats{
+    
+    static const int numMagnitudeBins = 16;
+    static const int numDirectionBins = 8;
+    
+    float meanX, meanY;
+    float medianX, medianY;
+    int numMoving;
+    float movingFraction;           // of the pixels looked at
+    float magnitudeHistogram[numMagnitudeBins];     // 0 .. maxMagnitude, pixel counts
+    float directionHistogram[numDirectionBins];     // magnitude weighted, bin 0 = +x, counter clockwise
+    float dominantDirection;        // radians, centre of the strongest direction bin
+    float dominantStrength;         // share of the total magnitude in that bin (0 - 1)
+    
+    static float maxMagnitude;
+};
@@ -0,0 +1,214 @@
+//
+//  FlowWorker.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FlowWorker.hpp"
+
+//--------------------------------------------------------------
+
+FlowWorker::FlowWorker(){
+    
+    threaded = true;
+    useMask = false;
+    hasPending = false;
+    hasReady = false;
+    hasFront = false;
+    engineSteps = 0;
+    droppedFrames = 0;
+    latencyMillis = 0;
+    framesBehind = 0;
+    decimate = 0.25;
+    
+    // the front result is read (latency, cost, stats) before the first field arrives
+    FlowResult * results[] = { &back, &ready, &front };
+    for(FlowResult * r : results){
+        r->frame = 0;
+        r->captureMicros = 0;
+        r->publishedMicros = 0;
+        r->finishedMicros = 0;
+        memset(&r->stats, 0, sizeof(r->stats));
+        r->computeMillis = 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+FlowWorker::~FlowWorker(){
+    stop();
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::setup(int srcWidth, int srcHeight, float _decimate){
+    
+    decimate = _decimate;
+    flowStage.setup(srcWidth, srcHeight, decimate);
+    
+    // input buffers are allocated once, publish only copies into them
+    int w = srcWidth * decimate;
+    int h = srcHeight * decimate;
+    pending.luminance.create(h, w, CV_8UC1);
+    active.luminance.create(h, w, CV_8UC1);
+    pending.mask.create(h, w, CV_8UC1);
+    active.mask.create(h, w, CV_8UC1);
+    
+    if(threaded) startThread();
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::stop(){
+    
+    if(!isThreadRunning()) return;
+    stopThread();
+    
+    // taking the lock first means the worker is either already waiting or will see the flag
+    { std::lock_guard<std::mutex> lck(mutex); }
+    wake.notify_all();
+    waitForThread(false);
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::publish(const cv::Mat & luminance, const ofRectangle & roi, const vector<ofPoint> & maskPoints, const cv::Mat & mask, bool mirror,
+                         uint64_t captureMicros){
+    
+    std::unique_lock<std::mutex> lck(mutex);
+    
+    if(hasPending) droppedFrames++;
+    luminance.copyTo(pending.luminance);
+    pending.roi = roi;
+    pending.maskPoints = maskPoints;
+    pending.useMask = useMask;
+    if(useMask) mask.copyTo(pending.mask);
+    pending.mirror = mirror;
+    pending.frame = ofGetFrameNum();
+    pending.captureMicros = captureMicros;
+    pending.publishedMicros = ofGetElapsedTimeMicros();
+    hasPending = true;
+    
+    lck.unlock();
+    
+    if(isThreadRunning()) wake.notify_one();
+    else process();
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::threadedFunction(){
+    
+    Profiler::setThreadName("flow");
+    while(isThreadRunning()){
+        process();
+    }
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::process(){
+    
+    // take the newest input
+    std::unique_lock<std::mutex> lck(mutex);
+    if(isThreadRunning()){
+        wake.wait(lck, [this]{ return hasPending || !isThreadRunning(); });
+    }
+    if(!hasPending) return;
+    std::swap(pending, active);
+    hasPending = false;
+    int steps = engineSteps;
+    engineSteps = 0;
+    lck.unlock();
+    
+    // the slow part, no lock held
+    for(int i = 0; i < steps; i++) flowStage.nextEngine();
+    
+    flowStage.setTrackPoints(active.maskPoints, active.mirror);
+    flowStage.useMask = active.useMask;
+    if(active.useMask) flowStage.setMask(active.mask, active.mirror);
+    
+    if(!flowStage.update(active.luminance, active.roi)) return;
+    
+    back.frame = active.frame;
+    back.captureMicros = active.captureMicros;
+    back.publishedMicros = active.publishedMicros;
+    back.finishedMicros = ofGetElapsedTimeMicros();
+    back.stats = flowStage.getStats();
+    back.grid = flowStage.getGrid();
+    flowStage.getFlow().copyTo(back.flow);
+    back.roi = flowStage.getRoi();
+    flowStage.getGray().copyTo(back.gray);
+    back.trackPoints = flowStage.getTrackPoints();
+    back.engineName = flowStage.getEngineName();
+    back.computeMillis = flowStage.getComputeMillis();
+    
+    // hand it over
+    lck.lock();
+    std::swap(back, ready);
+    hasReady = true;
+}
+
+//--------------------------------------------------------------
+
+bool FlowWorker::fetch(){
+    
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        if(!hasReady) return false;
+        std::swap(ready, front);
+        hasReady = false;
+    }
+    hasFront = true;
+    
+    float latency = (ofGetElapsedTimeMicros() - front.publishedMicros) * 0.001;
+    float behind = ofGetFrameNum() - front.frame;
+    latencyMillis = latencyMillis * 0.9 + latency * 0.1;
+    framesBehind = framesBehind * 0.9 + behind * 0.1;
+    return true;
+}
+
+//--------------------------------------------------------------
+
+const FlowResult & FlowWorker::getResult(){
+    return front;
+}
+
+//--------------------------------------------------------------
+
+bool FlowWorker::hasResult(){
+    return hasFront;
+}
+
+//--------------------------------------------------------------
+
+void FlowWorker::nextEngine(){
+    
+    std::lock_guard<std::mutex> lck(mutex);
+    engineSteps++;
+}
+
+//--------------------------------------------------------------
+
+float FlowWorker::getDecimate(){
+    return decimate;
+}
+
+//--------------------------------------------------------------
+
+float FlowWorker::getLatencyMillis(){
+    return latencyMillis;
+}
+
+//--------------------------------------------------------------
+
+float FlowWorker::getFramesBehind(){
+    return framesBehind;
+}
+
+//--------------------------------------------------------------
+
+int FlowWorker::getDroppedFrames(){
+    return droppedFrames;
+}
@@ -0,0 +1,109 @@
+//
+//  FlowWorker.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Runs FlowStage on its own thread, one frame behind the main loop. The main thread only
+// publishes a frame (a copy of the decimated luminance plus the roi / body points / mask that go with it)
+// and picks up the newest finished field, so the flow cost no longer lands on frame time.
+// Inputs and results are swapped between buffers under a short lock, never computed under it.
+// If frames come in faster than the flow is worked out, the older unstarted frame is dropped.
+
+#pragma once
+
+#ifndef FlowWorker_hpp
+#define FlowWorker_hpp
+
+#include <stdio.h>
+#include <condition_variable>
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "FlowStage.hpp"
+
+#endif /* FlowWorker_hpp */
+
+
+// everything the main thread needs from one finished field
+struct FlowResult{
+    
+    uint64_t frame;                 // app frame the input was published on
+    uint64_t captureMicros;         // when the kinect frame it came from was picked up
+    uint64_t publishedMicros;
+    uint64_t finishedMicros;
+    
+    FlowStats stats;
+    FlowGrid grid;
+    cv::Mat flow;                   // copy of the field, for the debug view
+    ofRectangle roi;
+    cv::Mat gray;                   // the grey frame the field ends on, for session recording
+    vector<cv::Point2f> trackPoints;
+    string engineName;
+    float computeMillis;
+};
+
+
+class FlowWorker : public ofThread{
+    
+public:
+    FlowWorker();
+    ~FlowWorker();
+    
+    void setup(int srcWidth, int srcHeight, float decimate);
+    void stop();
+    
+    // main thread: hand over this frame's input (copied), returns straight away.
+    // luminance and mask are the pyramid levels at the worker's decimation, maskPoints are full resolution.
+    void publish(const cv::Mat & luminance, const ofRectangle & roi, const vector<ofPoint> & maskPoints, const cv::Mat & mask, bool mirror,
+                 uint64_t captureMicros);
+    
+    // main thread: swaps in the newest finished field, true if there was one
+    bool fetch();
+    const FlowResult & getResult();
+    bool hasResult();
+    
+    void nextEngine();              // applied by the worker before its next field
+    float getDecimate();
+    
+    // latency accounting, all smoothed
+    float getLatencyMillis();       // publish -> picked up by the main thread
+    float getFramesBehind();        // app frames between publishing an input and using its field
+    int getDroppedFrames();
+    
+    bool threaded;                  // false runs the flow inline in publish (for debugging)
+    bool useMask;
+    
+private:
+    void threadedFunction();
+    void process();
+    
+    struct FlowJob{
+        cv::Mat luminance;
+        ofRectangle roi;
+        vector<ofPoint> maskPoints;
+        cv::Mat mask;
+        bool useMask;
+        bool mirror;
+        uint64_t frame;
+        uint64_t captureMicros;
+        uint64_t publishedMicros;
+    };
+    
+    FlowStage flowStage;            // only ever touched by the worker (or by publish when not threaded)
+    
+    FlowJob pending, active;        // pending is shared, active is the worker's
+    bool hasPending;
+    
+    FlowResult back, ready, front;  // back is the worker's, ready is shared, front is the main thread's
+    bool hasReady;
+    bool hasFront;
+    
+    std::condition_variable wake;
+    int engineSteps;
+    int droppedFrames;
+    float latencyMillis;
+    float framesBehind;
+    float decimate;
+    
+};
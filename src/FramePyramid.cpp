@@ -0,0 +1,132 @@
+//
+//  FramePyramid.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "FramePyramid.hpp"
+
+//--------------------------------------------------------------
+
+FramePyramid::FramePyramid(){
+    
+    luminanceLevel = numLevels - 1;
+    allLuminance = false;
+}
+
+//--------------------------------------------------------------
+
+void FramePyramid::setup(int width, int height){
+    
+    // every level allocated once, here (mask level 0 is whatever build is given)
+    luminance[0].create(height, width, CV_8UC1);
+    for(int i = 1; i < numLevels; i++){
+        mask[i].create(height >> i, width >> i, CV_8UC1);
+        luminance[i].create(height >> i, width >> i, CV_8UC1);
+    }
+}
+
+//--------------------------------------------------------------
+
+void FramePyramid::build(const cv::Mat & _mask, const ofPixels & rgb){
+    
+    mask[0] = _mask;
+    for(int i = 1; i < numLevels; i++){
+        halveMask(mask[i - 1], mask[i]);
+    }
+    
+    if(!allLuminance){
+        int level = ofClamp(luminanceLevel, 0, numLevels - 1);
+        luminanceFromRgb(rgb, level, luminance[level]);
+        return;
+    }
+    
+    cv::Mat frame(rgb.getHeight(), rgb.getWidth(), CV_8UC3, (void *) rgb.getData());
+    cv::cvtColor(frame, luminance[0], CV_RGB2GRAY);
+    for(int i = 1; i < numLevels; i++){
+        halveLuminance(luminance[i - 1], luminance[i]);
+    }
+}
+
+//--------------------------------------------------------------
+
+const cv::Mat & FramePyramid::getMask(int level){
+    return mask[(int) ofClamp(level, 0, numLevels - 1)];
+}
+
+//--------------------------------------------------------------
+
+const cv::Mat & FramePyramid::getLuminance(int level){
+    return luminance[(int) ofClamp(level, 0, numLevels - 1)];
+}
+
+//--------------------------------------------------------------
+
+float FramePyramid::getScale(int level){
+    return 1.0 / (1 << (int) ofClamp(level, 0, numLevels - 1));
+}
+
+//--------------------------------------------------------------
+
+void FramePyramid::halveLuminance(const cv::Mat & src, cv::Mat & dst){
+    
+    // rounded mean of each 2x2 block (the same as an INTER_AREA halving).
+    // two row pointers and no branches, so the inner loop vectorises.
+    for(int y = 0; y < dst.rows; y++){
+        const unsigned char * a = src.ptr<unsigned char>(y * 2);
+        const unsigned char * b = src.ptr<unsigned char>(y * 2 + 1);
+        unsigned char * d = dst.ptr<unsigned char>(y);
+        
+        for(int x = 0; x < dst.cols; x++){
+            unsigned int sum = a[x * 2] + a[x * 2 + 1] + b[x * 2] + b[x * 2 + 1];
+            d[x] = (sum + 2) >> 2;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void FramePyramid::luminanceFromRgb(const ofPixels & rgb, int level, cv::Mat & dst){
+    
+    // cvtColor's fixed point RGB -> grey weights (14 bits), applied to the sums of each
+    // (1 << level)^2 block and rounded once. the sums fit 32 bits up to level 2 (16 pixels).
+    int block = 1 << level;
+    int shift = 14 + 2 * level;
+    unsigned int round = 1u << (shift - 1);
+    int width = rgb.getWidth();
+    const unsigned char * data = rgb.getData();
+    
+    for(int y = 0; y < dst.rows; y++){
+        unsigned char * d = dst.ptr<unsigned char>(y);
+        for(int x = 0; x < dst.cols; x++){
+            unsigned int r = 0, g = 0, b = 0;
+            for(int by = 0; by < block; by++){
+                const unsigned char * p = data + ((y * block + by) * width + x * block) * 3;
+                for(int bx = 0; bx < block; bx++, p += 3){
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            d[x] = (r * 4899 + g * 9617 + b * 1868 + round) >> shift;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void FramePyramid::halveMask(const cv::Mat & src, cv::Mat & dst){
+    
+    // majority vote of each 2x2 block: at least two of the four set
+    for(int y = 0; y < dst.rows; y++){
+        const unsigned char * a = src.ptr<unsigned char>(y * 2);
+        const unsigned char * b = src.ptr<unsigned char>(y * 2 + 1);
+        unsigned char * d = dst.ptr<unsigned char>(y);
+        
+        for(int x = 0; x < dst.cols; x++){
+            unsigned int sum = a[x * 2] + a[x * 2 + 1] + b[x * 2] + b[x * 2 + 1];
+            d[x] = sum >= 510 ? 255 : 0;
+        }
+    }
+}
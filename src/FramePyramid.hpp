@@ -0,0 +1,57 @@
+//
+//  FramePyramid.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Full, 1/2 and 1/4 resolution copies of the body mask and of the colour frame's luminance,
+// built once per new kinect frame. Flow, contours and the debug view pick the level they need
+// from here instead of each resampling on their own.
+// Halving is a plain 2x2 box over whole rows, written so the compiler vectorises it.
+// Only the flow reads the luminance, so by default just its level is made, straight from the
+// colour frame in one pass; the full size conversion and halvings are only done on request.
+
+#pragma once
+
+#ifndef FramePyramid_hpp
+#define FramePyramid_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#endif /* FramePyramid_hpp */
+
+
+class FramePyramid{
+    
+public:
+    static const int numLevels = 3;
+    
+    FramePyramid();
+    
+    void setup(int width, int height);
+    
+    // mask is the mirrored body mask (level 0 just wraps it, no copy), rgb the kinect colour frame
+    void build(const cv::Mat & mask, const ofPixels & rgb);
+    
+    // mask levels stay binary (0 / 255, a cell is set when at least half of it was)
+    const cv::Mat & getMask(int level);
+    const cv::Mat & getLuminance(int level);
+    
+    int luminanceLevel;     // the luminance level build makes
+    bool allLuminance;      // make every luminance level (for looking at them), not just luminanceLevel
+    
+    // size of a level relative to full resolution (1, 0.5, 0.25)
+    static float getScale(int level);
+    
+private:
+    static void halveLuminance(const cv::Mat & src, cv::Mat & dst);
+    static void halveMask(const cv::Mat & src, cv::Mat & dst);
+    static void luminanceFromRgb(const ofPixels & rgb, int level, cv::Mat & dst);
+    
+    cv::Mat mask[numLevels];
+    cv::Mat luminance[numLevels];
+    
+};
@@ -0,0 +1,145 @@
+//
+//  GestureDetector.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "GestureDetector.hpp"
+
+//--------------------------------------------------------------
+
+string GestureEvent::getName(Type type){
+    
+    switch(type){
+        case WAVE_LEFT: return "wave left";
+        case WAVE_RIGHT: return "wave right";
+        case PUSH: return "push";
+        case STILLNESS: return "stillness";
+        default: return "";
+    }
+}
+
+//--------------------------------------------------------------
+
+GestureDetector::GestureDetector(){
+    
+    // the old trigger was |flowX| >= 3
+    swingEnter = 3;
+    swingExit = 1.5;
+    minSwingTime = 0.1;
+    minMovingFraction = 0.02;
+    
+    pushFraction = 0.25;
+    pushMaxStrength = 0.35;
+    minPushTime = 0.15;
+    
+    stillFraction = 0.01;
+    stillTime = 2;
+    
+    countWindow = 3;
+    
+    swingDirection = 0;
+    swingStart = 0;
+    swingPeak = 0;
+    swingFired = false;
+    pushing = false;
+    pushStart = 0;
+    pushFired = false;
+    still = false;
+    stillStart = 0;
+    stillFired = false;
+    hasLast = false;
+    lastType = GestureEvent::STILLNESS;
+}
+
+//--------------------------------------------------------------
+
+void GestureDetector::update(const FlowStats & stats, float time){
+    
+    float x = stats.movingFraction >= minMovingFraction ? stats.meanX : 0;
+    
+    // 1. swings. positive x is a swing to the right on screen (the sign the particles use)
+    int direction = x >= swingEnter ? 1 : (x <= -swingEnter ? -1 : 0);
+    
+    if(direction != 0 && direction != swingDirection){
+        // a new swing, or a straight reversal of the last one
+        swingDirection = direction;
+        swingStart = time;
+        swingPeak = 0;
+        swingFired = false;
+    } else if(swingDirection != 0 && x * swingDirection < swingExit){
+        swingDirection = 0;
+    }
+    
+    if(swingDirection != 0){
+        swingPeak = max(swingPeak, fabsf(x));
+        if(!swingFired && time - swingStart >= minSwingTime){
+            swingFired = true;
+            emit(swingDirection > 0 ? GestureEvent::WAVE_RIGHT : GestureEvent::WAVE_LEFT, time, swingPeak);
+        }
+    }
+    
+    // 2. push: plenty of motion that doesn't agree on a direction (and isn't a swing)
+    bool pushLike = swingDirection == 0 && stats.movingFraction >= pushFraction && stats.dominantStrength <= pushMaxStrength;
+    if(!pushing && pushLike){
+        pushing = true;
+        pushStart = time;
+        pushFired = false;
+    } else if(pushing && stats.movingFraction < pushFraction * 0.5){
+        pushing = false;
+    }
+    if(pushing && !pushFired && pushLike && time - pushStart >= minPushTime){
+        pushFired = true;
+        emit(GestureEvent::PUSH, time, stats.movingFraction);
+    }
+    
+    // 3. stillness, once per still spell
+    if(!still && stats.movingFraction < stillFraction){
+        still = true;
+        stillStart = time;
+        stillFired = false;
+    } else if(still && stats.movingFraction >= stillFraction * 2){
+        still = false;
+    }
+    if(still && !stillFired && time - stillStart >= stillTime){
+        stillFired = true;
+        emit(GestureEvent::STILLNESS, time, stats.movingFraction);
+    }
+    
+    // forget events that fell out of the counting window
+    for(int i = 0; i < GestureEvent::NUM_TYPES; i++){
+        while(!history[i].empty() && time - history[i].front() > countWindow) history[i].pop_front();
+    }
+}
+
+//--------------------------------------------------------------
+
+void GestureDetector::emit(GestureEvent::Type type, float time, float strength){
+    
+    history[type].push_back(time);
+    while(time - history[type].front() > countWindow) history[type].pop_front();
+    
+    GestureEvent e;
+    e.type = type;
+    e.time = time;
+    e.strength = strength;
+    e.count = history[type].size();
+    
+    lastType = type;
+    hasLast = true;
+    ofLogVerbose("GestureDetector") << GestureEvent::getName(type) << " (" << e.count << " in " << countWindow << "s)";
+    ofNotifyEvent(gestureEvent, e);
+}
+
+//--------------------------------------------------------------
+
+int GestureDetector::getCount(GestureEvent::Type type){
+    return history[type].size();
+}
+
+//--------------------------------------------------------------
+
+string GestureDetector::getLastName(){
+    return hasLast ? GestureEvent::getName(lastType) : "none";
+}
@@ -0,0 +1,95 @@
+//
+//  GestureDetector.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Turns the stream of optical flow statistics into discrete gestures: a wave left or right
+// (one event per sustained swing, not per frame), a push (lots of motion with no single direction,
+// e.g. towards the camera) and stillness. Thresholds use hysteresis and every duration is in
+// seconds, so the result doesn't depend on the frame rate.
+// Listeners subscribe to gestureEvent.
+
+#pragma once
+
+#ifndef GestureDetector_hpp
+#define GestureDetector_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "FlowStats.hpp"
+
+#endif /* GestureDetector_hpp */
+
+
+struct GestureEvent{
+    
+    enum Type{
+        WAVE_LEFT,
+        WAVE_RIGHT,
+        PUSH,
+        STILLNESS,
+        NUM_TYPES
+    };
+    
+    Type type;
+    float time;             // seconds, as passed to GestureDetector::update
+    float strength;         // peak flow of the swing / moving fraction of the push
+    int count;              // events of this type inside the counting window, this one included
+    
+    static string getName(Type type);
+};
+
+
+class GestureDetector{
+    
+public:
+    GestureDetector();
+    
+    // once per new flow field
+    void update(const FlowStats & stats, float time);
+    
+    int getCount(GestureEvent::Type type);  // events of this type in the last countWindow seconds
+    string getLastName();                   // for the debug text
+    
+    ofEvent<GestureEvent> gestureEvent;
+    
+    // swings: mean horizontal flow has to pass swingEnter for minSwingTime, and drop under swingExit to end
+    float swingEnter;
+    float swingExit;
+    float minSwingTime;
+    float minMovingFraction;        // ignore the mean when almost nothing is moving
+    
+    // push: at least pushFraction of the region moving with no dominant direction
+    float pushFraction;
+    float pushMaxStrength;
+    float minPushTime;
+    
+    // stillness: under stillFraction moving for stillTime
+    float stillFraction;
+    float stillTime;
+    
+    float countWindow;
+    
+private:
+    void emit(GestureEvent::Type type, float time, float strength);
+    
+    int swingDirection;             // -1 left, 0 none, 1 right
+    float swingStart;
+    float swingPeak;
+    bool swingFired;
+    
+    bool pushing;
+    float pushStart;
+    bool pushFired;
+    
+    bool still;
+    float stillStart;
+    bool stillFired;
+    
+    deque<float> history[GestureEvent::NUM_TYPES];
+    GestureEvent::Type lastType;
+    bool hasLast;
+    
+};
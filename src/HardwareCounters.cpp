@@ -0,0 +1,178 @@
+//
+//  HardwareCounters.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "HardwareCounters.hpp"
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+bool HardwareCounters::enabled = false;
+
+static const char * counterNames[NUM_HW_COUNTERS] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"
+};
+
+// which counters opened on the first thread that tried, and why not if none did
+static std::atomic<int> availableMask(0);
+static std::atomic<bool> reported(false);
+static std::mutex statusMutex;
+static string status = "not opened yet";
+
+//--------------------------------------------------------------
+
+#ifdef __linux__
+
+// one group per thread, led by the cycle counter so they are all scheduled together.
+// like the profiler's rings they stay open until the app quits.
+struct CounterGroup{
+    bool opened;
+    bool working;
+    int leader;
+    int fds[NUM_HW_COUNTERS];
+    int slots[NUM_HW_COUNTERS];     // position in the group read, -1 if it didn't open
+    int numOpen;
+};
+
+static thread_local CounterGroup group = { false, false, -1 };
+
+//--------------------------------------------------------------
+
+static int openCounter(HardwareCounter counter, int groupFd){
+    
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;        // user space only, which also works at perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    
+    switch(counter){
+        case HW_CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case HW_INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case HW_L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case HW_LLC_MISSES: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case HW_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        default: return -1;
+    }
+    
+    // this thread, any cpu
+    return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+//--------------------------------------------------------------
+
+static void openGroup(){
+    
+    group.opened = true;
+    group.working = false;
+    group.numOpen = 0;
+    for(int i = 0; i < NUM_HW_COUNTERS; i++){
+        group.fds[i] = -1;
+        group.slots[i] = -1;
+    }
+    
+    group.leader = openCounter(HW_CYCLES, -1);
+    if(group.leader < 0){
+        string why = string("perf_event_open failed: ") + strerror(errno)
+        + (errno == EACCES || errno == EPERM ? " (check /proc/sys/kernel/perf_event_paranoid)" : "");
+        {
+            std::lock_guard<std::mutex> lck(statusMutex);
+            status = why;
+        }
+        if(!reported.exchange(true)) ofLogWarning("HardwareCounters") << why << ", stages will only be timed";
+        return;
+    }
+    group.fds[HW_CYCLES] = group.leader;
+    group.slots[HW_CYCLES] = group.numOpen++;
+    
+    // the rest are optional, a machine without one just leaves it at 0
+    for(int i = HW_CYCLES + 1; i < NUM_HW_COUNTERS; i++){
+        group.fds[i] = openCounter((HardwareCounter) i, group.leader);
+        if(group.fds[i] >= 0) group.slots[i] = group.numOpen++;
+    }
+    
+    ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    group.working = true;
+    
+    int mask = 0;
+    for(int i = 0; i < NUM_HW_COUNTERS; i++) if(group.slots[i] >= 0) mask |= 1 << i;
+    int expected = 0;
+    if(availableMask.compare_exchange_strong(expected, mask)){
+        std::lock_guard<std::mutex> lck(statusMutex);
+        status = "";
+        ofLogNotice("HardwareCounters") << group.numOpen << " of " << NUM_HW_COUNTERS << " counters available";
+    }
+}
+
+#endif
+
+//--------------------------------------------------------------
+
+bool HardwareCounters::read(HardwareCounts & out){
+    
+    out.valid = false;
+    memset(out.values, 0, sizeof(out.values));
+    
+#ifdef __linux__
+    if(!group.opened) openGroup();
+    if(!group.working) return false;
+    
+    // nr, time enabled, time running, then one value per open counter in the order they were opened
+    uint64_t buffer[3 + NUM_HW_COUNTERS];
+    if(::read(group.leader, buffer, sizeof(buffer)) < (ssize_t) ((3 + group.numOpen) * sizeof(uint64_t))) return false;
+    
+    uint64_t enabledTime = buffer[1];
+    uint64_t runningTime = buffer[2];
+    if(runningTime == 0) return false;
+    
+    // scaled up if the group had to share the PMU with someone else's
+    double scale = (double) enabledTime / runningTime;
+    for(int i = 0; i < NUM_HW_COUNTERS; i++){
+        if(group.slots[i] >= 0) out.values[i] = buffer[3 + group.slots[i]] * scale;
+    }
+    out.valid = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+
+bool HardwareCounters::isAvailable(HardwareCounter counter){
+    return (availableMask.load() >> counter) & 1;
+}
+
+//--------------------------------------------------------------
+
+string HardwareCounters::getName(HardwareCounter counter){
+    return counterNames[counter];
+}
+
+//--------------------------------------------------------------
+
+string HardwareCounters::getStatus(){
+    
+#ifdef __linux__
+    std::lock_guard<std::mutex> lck(statusMutex);
+    return status;
+#else
+    return "hardware counters need Linux (perf_event_open)";
+#endif
+}
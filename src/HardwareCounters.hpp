@@ -0,0 +1,52 @@
+//
+//  HardwareCounters.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Optional CPU counters (cycles, instructions, L1 / LLC misses, branch misses) through Linux's
+// perf_event_open, counting user space on the calling thread only. Each thread opens its own group the
+// first time it reads. Anywhere they can't be had (macOS, a VM without a PMU, perf_event_paranoid too
+// high) read() just returns false and getStatus() says why, nothing else changes.
+
+#pragma once
+
+#ifndef HardwareCounters_hpp
+#define HardwareCounters_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* HardwareCounters_hpp */
+
+
+enum HardwareCounter{
+    HW_CYCLES,
+    HW_INSTRUCTIONS,
+    HW_L1D_MISSES,
+    HW_LLC_MISSES,
+    HW_BRANCH_MISSES,
+    NUM_HW_COUNTERS
+};
+
+
+struct HardwareCounts{
+    bool valid;
+    uint64_t values[NUM_HW_COUNTERS];   // running totals, 0 for a counter this machine doesn't have
+};
+
+
+class HardwareCounters{
+    
+public:
+    static bool enabled;            // off by default, every read is a system call
+    
+    // this thread's totals so far
+    static bool read(HardwareCounts & out);
+    
+    static bool isAvailable(HardwareCounter counter);
+    static string getName(HardwareCounter counter);
+    static string getStatus();      // why not, or "" when they work
+    
+};
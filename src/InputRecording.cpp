@@ -0,0 +1,188 @@
+//
+//  InputRecording.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "InputRecording.hpp"
+
+static const char magic[4] = { 'M', 'K', 'I', 'N' };
+
+//--------------------------------------------------------------
+
+InputRecorder::InputRecorder(){
+    file = NULL;
+    frames = 0;
+}
+
+//--------------------------------------------------------------
+
+InputRecorder::~InputRecorder(){
+    stop();
+}
+
+//--------------------------------------------------------------
+
+void InputRecorder::start(){
+    
+    stop();
+    ofDirectory::createDirectory("inputs", true, true);
+    path = "inputs/" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".inputs";
+    file = fopen(ofToDataPath(path).c_str(), "wb");
+    if(!file){
+        ofLogError("InputRecorder") << "couldn't open " << path;
+        return;
+    }
+    fwrite(magic, 1, 4, file);
+    frames = 0;
+    ofLogNotice("InputRecorder") << "recording particle inputs to " << path;
+}
+
+//--------------------------------------------------------------
+
+void InputRecorder::stop(){
+    
+    if(!file) return;
+    fclose(file);
+    file = NULL;
+    ofLogNotice("InputRecorder") << "recorded " << frames << " frames to " << path;
+}
+
+//--------------------------------------------------------------
+
+bool InputRecorder::isRecording(){
+    return file != NULL;
+}
+
+//--------------------------------------------------------------
+
+void InputRecorder::record(const ParticleSystem & system){
+    
+    if(!file) return;
+    
+    InputFrame frame;
+    frame.mode = system.modeCounter;
+    frame.flowX = system.flowX;
+    frame.flowY = system.flowY;
+    // each group's outline is the one it follows, so an empty slot replays as the body it was handed to
+    frame.bodies.resize(system.numBodies);
+    for(int i = 0; i < system.numBodies; i++) frame.bodies[i] = system.bodies[system.getFollowedBody(i)];
+    frame.flowField = system.flowField;
+    InputPlayer::write(file, frame);
+    frames++;
+}
+
+//--------------------------------------------------------------
+
+bool InputPlayer::load(const string & path){
+    
+    frames.clear();
+    FILE * file = fopen(ofToDataPath(path).c_str(), "rb");
+    if(!file) return false;
+    
+    char header[4];
+    if(fread(header, 1, 4, file) != 4 || memcmp(header, magic, 4) != 0){
+        ofLogError("InputPlayer") << path << " isn't an input recording";
+        fclose(file);
+        return false;
+    }
+    
+    InputFrame frame;
+    while(read(file, frame)) frames.push_back(frame);
+    fclose(file);
+    return !frames.empty();
+}
+
+//--------------------------------------------------------------
+
+void InputPlayer::clear(){
+    frames.clear();
+}
+
+//--------------------------------------------------------------
+
+void InputPlayer::add(const InputFrame & frame){
+    frames.push_back(frame);
+}
+
+//--------------------------------------------------------------
+
+int InputPlayer::size(){
+    return frames.size();
+}
+
+//--------------------------------------------------------------
+
+const InputFrame & InputPlayer::getFrame(int i){
+    return frames[i];
+}
+
+//--------------------------------------------------------------
+
+void InputPlayer::apply(int i, ParticleSystem & system){
+    
+    const InputFrame & frame = frames[i];
+    system.modeCounter = frame.mode;
+    system.setNumBodies(frame.bodies.size());
+    for(int b = 0; b < frame.bodies.size(); b++){
+        system.receiveBody(b, frame.bodies[b]);
+    }
+    system.receiveFlow(frame.flowX, frame.flowY);
+    system.flowField = frame.flowField;
+}
+
+//--------------------------------------------------------------
+
+void InputPlayer::write(FILE * file, const InputFrame & frame){
+    
+    int numBodies = frame.bodies.size();
+    fwrite(&frame.mode, sizeof(int), 1, file);
+    fwrite(&frame.flowX, sizeof(float), 1, file);
+    fwrite(&frame.flowY, sizeof(float), 1, file);
+    fwrite(&numBodies, sizeof(int), 1, file);
+    
+    for(int b = 0; b < numBodies; b++){
+        const vector<ofPoint> & points = frame.bodies[b].getVertices();
+        int numPoints = points.size();
+        int closed = frame.bodies[b].isClosed();
+        fwrite(&numPoints, sizeof(int), 1, file);
+        fwrite(&closed, sizeof(int), 1, file);
+        for(int i = 0; i < numPoints; i++){
+            float xy[2] = { points[i].x, points[i].y };
+            fwrite(xy, sizeof(float), 2, file);
+        }
+    }
+    
+    // plain data, written as it is
+    fwrite(&frame.flowField, sizeof(FlowGrid), 1, file);
+}
+
+//--------------------------------------------------------------
+
+bool InputPlayer::read(FILE * file, InputFrame & frame){
+    
+    int numBodies;
+    if(fread(&frame.mode, sizeof(int), 1, file) != 1) return false;
+    if(fread(&frame.flowX, sizeof(float), 1, file) != 1) return false;
+    if(fread(&frame.flowY, sizeof(float), 1, file) != 1) return false;
+    if(fread(&numBodies, sizeof(int), 1, file) != 1 || numBodies < 0 || numBodies > ParticleSystem::maxBodies) return false;
+    
+    frame.bodies.resize(numBodies);
+    for(int b = 0; b < numBodies; b++){
+        int numPoints, closed;
+        if(fread(&numPoints, sizeof(int), 1, file) != 1 || numPoints < 0) return false;
+        if(fread(&closed, sizeof(int), 1, file) != 1) return false;
+        
+        ofPolyline & line = frame.bodies[b];
+        line.clear();
+        for(int i = 0; i < numPoints; i++){
+            float xy[2];
+            if(fread(xy, sizeof(float), 2, file) != 2) return false;
+            line.addVertex(xy[0], xy[1]);
+        }
+        if(closed) line.close();
+    }
+    
+    return fread(&frame.flowField, sizeof(FlowGrid), 1, file) == 1;
+}
@@ -0,0 +1,70 @@
+//
+//  InputRecording.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Records exactly what the particle system is given each frame (mode, body outlines, global flow,
+// local flow field), taken right before ParticleSystem::update, so a session can be replayed through
+// the simulation with no kinect. Used by the determinism harness in bench/.
+// Binary, native endianness: a "MKIN" header, then one block per frame.
+
+#pragma once
+
+#ifndef InputRecording_hpp
+#define InputRecording_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "ParticleSystem.hpp"
+
+#endif /* InputRecording_hpp */
+
+
+struct InputFrame{
+    int mode;
+    float flowX, flowY;
+    vector<ofPolyline> bodies;
+    FlowGrid flowField;
+};
+
+
+class InputRecorder{
+    
+public:
+    InputRecorder();
+    ~InputRecorder();
+    
+    void start();                   // bin/data/inputs/<timestamp>.inputs
+    void stop();
+    bool isRecording();
+    void record(const ParticleSystem & system);
+    
+private:
+    FILE * file;
+    string path;
+    int frames;
+    
+};
+
+
+class InputPlayer{
+    
+public:
+    bool load(const string & path);
+    void clear();
+    void add(const InputFrame & frame);
+    int size();
+    const InputFrame & getFrame(int i);
+    
+    // hand frame i to the system, the same way ofApp does
+    void apply(int i, ParticleSystem & system);
+    
+    static void write(FILE * file, const InputFrame & frame);
+    static bool read(FILE * file, InputFrame & frame);
+    
+private:
+    vector<InputFrame> frames;
+    
+};
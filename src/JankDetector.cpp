@@ -0,0 +1,249 @@
+//
+//  JankDetector.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "JankDetector.hpp"
+
+//--------------------------------------------------------------
+
+JankDetector::JankDetector(){
+    
+    enabled = false;
+    budgetMillis = 20;
+    cooldownSeconds = 10;
+    warmupFrames = 120;
+    depthWidth = 0;
+    depthHeight = 0;
+    kinectSequence = 0;
+    kinectNew = false;
+    frameStart = 0;
+    lastDump = 0;
+    frames = 0;
+    spikes = 0;
+    writing = false;
+    writer = NULL;
+    live.frameNext = live.frameCount = live.kinectNext = live.kinectCount = 0;
+    spare.frameNext = spare.frameCount = spare.kinectNext = spare.kinectCount = 0;
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::setup(int _depthWidth, int _depthHeight, BackgroundWriter * _writer){
+    
+    depthWidth = _depthWidth;
+    depthHeight = _depthHeight;
+    writer = _writer;
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::allocate(History & h){
+    
+    // all up front, so recording never allocates once the contour buffers have grown
+    h.frames.resize(historyFrames);
+    h.frameNext = h.frameCount = 0;
+    h.kinect.resize(kinectFrames);
+    for(int i = 0; i < kinectFrames; i++){
+        h.kinect[i].depth.resize(depthWidth * depthHeight);
+    }
+    h.kinectNext = h.kinectCount = 0;
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::beginFrame(){
+    
+    uint64_t now = ofGetElapsedTimeMicros();
+    uint64_t last = frameStart;
+    frameStart = now;
+    kinectNew = false;
+    if(!enabled || last == 0) return;
+    
+    // first time on: allocate, and warm up again so the allocation itself isn't a spike
+    if(live.frames.empty()){
+        ofLogNotice("JankDetector") << "allocating " << 2 * kinectFrames * depthWidth * depthHeight * sizeof(unsigned short) / (1024 * 1024) << "MB of history";
+        allocate(live);
+        allocate(spare);
+        frames = 0;
+        return;
+    }
+    frames++;
+    
+    float frameMillis = (now - last) * 0.001;
+    if(live.frameCount > 0){
+        Frame & f = live.frames[(live.frameNext + historyFrames - 1) % historyFrames];
+        if(f.start == last) f.frameMillis = frameMillis;
+    }
+    
+    if(frames < warmupFrames || frameMillis <= budgetMillis) return;
+    spikes++;
+    if(lastDump != 0 && now - lastDump < cooldownSeconds * 1000000) return;
+    dump(ofToString(frameMillis, 1) + "ms frame");
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::recordKinect(const unsigned short * depth, const BodyContourFinder & contours){
+    
+    if(!enabled || live.kinect.empty()) return;
+    
+    KinectFrame & k = live.kinect[live.kinectNext];
+    k.sequence = kinectSequence++;
+    k.time = ofGetElapsedTimeMicros();
+    memcpy(k.depth.data(), depth, k.depth.size() * sizeof(unsigned short));
+    
+    // contour by contour, so the counts are enough to split the points again
+    k.points.clear();
+    k.counts.resize(contours.contours.size());
+    for(int i = 0; i < contours.contours.size(); i++){
+        const BodyContour & c = contours.contours[i];
+        k.points.insert(k.points.end(), contours.points.begin() + c.start, contours.points.begin() + c.start + c.count);
+        k.counts[i] = c.count;
+    }
+    
+    live.kinectNext = (live.kinectNext + 1) % kinectFrames;
+    live.kinectCount = min(live.kinectCount + 1, (int) kinectFrames);
+    kinectNew = true;
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::recordFrame(const ParticleSystem & system, const FlowStats & flow, int contourVertices){
+    
+    if(!enabled || live.frames.empty()) return;
+    
+    Frame & f = live.frames[live.frameNext];
+    f.frame = ofGetFrameNum();
+    f.start = frameStart;
+    f.frameMillis = 0;
+    f.kinectIndex = kinectNew ? kinectSequence - 1 : -1;
+    f.flow = flow;
+    f.contourVertices = contourVertices;
+    
+    // what the next system.update will see, as InputRecorder has it
+    f.inputs.mode = system.modeCounter;
+    f.inputs.flowX = system.flowX;
+    f.inputs.flowY = system.flowY;
+    f.inputs.bodies.resize(system.numBodies);
+    for(int i = 0; i < system.numBodies; i++) f.inputs.bodies[i] = system.bodies[system.getFollowedBody(i)];
+    f.inputs.flowField = system.flowField;
+    
+    live.frameNext = (live.frameNext + 1) % historyFrames;
+    live.frameCount = min(live.frameCount + 1, (int) historyFrames);
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::dump(const string & reason){
+    
+    if(writing){
+        ofLogNotice("JankDetector") << reason << ", still writing the last dump";
+        return;
+    }
+    if(live.frameCount == 0){
+        if(live.frames.empty()) ofLogNotice("JankDetector") << reason << ", not recording (press j to turn the detector on)";
+        return;
+    }
+    
+    // hand the history over and carry on recording into the spare, which is already allocated
+    std::swap(live, spare);
+    live.frameNext = live.frameCount = 0;
+    live.kinectNext = live.kinectCount = 0;
+    lastDump = ofGetElapsedTimeMicros();
+    
+    const Frame & first = spare.frames[(spare.frameNext - spare.frameCount + historyFrames) % historyFrames];
+    uint64_t from = first.start;
+    uint64_t to = lastDump;
+    
+    string dir = "jank/" + ofGetTimestampString("%Y%m%d-%H%M%S");
+    ofLogWarning("JankDetector") << reason << ", writing the last " << ofToString((to - from) * 0.000001, 1) << "s to " << dir;
+    
+    writing = true;
+    std::function<void()> job = [this, dir, from, to]{ write(dir, from, to); };
+    if(writer) writer->add(job);
+    else job();
+}
+
+//--------------------------------------------------------------
+
+void JankDetector::write(string dir, uint64_t from, uint64_t to){
+    
+    ofDirectory::createDirectory(dir + "/kinect", true, true);
+    
+    // frames, oldest first
+    ofstream csv(ofToDataPath(dir + "/frames.csv").c_str());
+    csv << "frame,time_us,frame_ms,mode,bodies,flow_mean_x,flow_mean_y,flow_moving_fraction,flow_dominant_direction,flow_dominant_strength,contour_vertices,kinect_frame" << endl;
+    
+    FILE * inputs = fopen(ofToDataPath(dir + "/particles.inputs").c_str(), "wb");
+    if(inputs) fwrite("MKIN", 1, 4, inputs);
+    
+    int firstKinect = spare.kinectCount > 0 ? spare.kinect[(spare.kinectNext - spare.kinectCount + kinectFrames) % kinectFrames].sequence : 0;
+    for(int i = 0; i < spare.frameCount; i++){
+        const Frame & f = spare.frames[(spare.frameNext - spare.frameCount + i + historyFrames) % historyFrames];
+        csv << f.frame << "," << f.start << "," << f.frameMillis << "," << f.inputs.mode << "," << f.inputs.bodies.size() << ","
+            << f.flow.meanX << "," << f.flow.meanY << "," << f.flow.movingFraction << "," << f.flow.dominantDirection << ","
+            << f.flow.dominantStrength << "," << f.contourVertices << "," << (f.kinectIndex >= firstKinect ? f.kinectIndex - firstKinect : -1) << endl;
+        if(inputs) InputPlayer::write(inputs, f.inputs);
+    }
+    if(inputs) fclose(inputs);
+    
+    // stage timings in the window. the profiler rings hold ~30s, so the window is still there
+    // when the writer gets to it.
+    vector<ProfileThread> threads;
+    Profiler::collect(threads);
+    ofstream stages(ofToDataPath(dir + "/stages.csv").c_str());
+    stages << "thread,stage,start_us,duration_us" << endl;
+    for(int t = 0; t < threads.size(); t++){
+        const vector<ProfileSample> & samples = threads[t].samples;
+        for(int i = 0; i < samples.size(); i++){
+            const ProfileSample & s = samples[i];
+            if(s.start + s.duration < from || s.start > to) continue;
+            stages << threads[t].name << "," << Profiler::getStageName(s.stage) << "," << s.start << "," << s.duration << endl;
+        }
+    }
+    
+    // kinect frames, numbered from 0 like the frames.csv column. pgm stores 16 bit big endian.
+    for(int i = 0; i < spare.kinectCount; i++){
+        const KinectFrame & k = spare.kinect[(spare.kinectNext - spare.kinectCount + i + kinectFrames) % kinectFrames];
+        char name[64];
+        
+        sprintf(name, "/kinect/depth_%05d.pgm", i);
+        FILE * pgm = fopen(ofToDataPath(dir + name).c_str(), "wb");
+        if(pgm){
+            fprintf(pgm, "P5\n%d %d\n65535\n", depthWidth, depthHeight);
+            vector<unsigned char> row(depthWidth * 2);
+            for(int y = 0; y < depthHeight; y++){
+                const unsigned short * src = &k.depth[y * depthWidth];
+                for(int x = 0; x < depthWidth; x++){
+                    row[x * 2] = src[x] >> 8;
+                    row[x * 2 + 1] = src[x] & 0xff;
+                }
+                fwrite(row.data(), 1, row.size(), pgm);
+            }
+            fclose(pgm);
+        }
+        
+        // "x y" per line, a blank line between contours
+        sprintf(name, "/kinect/contours_%05d.txt", i);
+        ofstream contours(ofToDataPath(dir + name).c_str());
+        int p = 0;
+        for(int c = 0; c < k.counts.size(); c++){
+            if(c > 0) contours << endl;
+            for(int j = 0; j < k.counts[c] && p < k.points.size(); j++, p++){
+                contours << k.points[p].x << " " << k.points[p].y << endl;
+            }
+        }
+    }
+    
+    ofLogNotice("JankDetector") << "wrote " << spare.frameCount << " frames and " << spare.kinectCount << " kinect frames to bin/data/" << dir;
+    writing = false;
+}
+
+//--------------------------------------------------------------
+
+int JankDetector::getSpikes(){
+    return spikes;
+}
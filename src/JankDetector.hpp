@@ -0,0 +1,101 @@
+//
+//  JankDetector.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Watches the frame time and, when a frame goes over budget, dumps the last few seconds to
+// bin/data/jank/<timestamp>/ so the spike can be looked at offline:
+//
+//     frames.csv          per frame: time, frame ms, mode, bodies, flow stats, contour vertices
+//     stages.csv          every profiler sample in the window (same columns as the profiler's csv)
+//     particles.inputs    the particle system's inputs (InputRecorder format), for bench --stream / --determinism
+//     kinect/             raw depth (16 bit pgm, millimetres) and contour points for each kinect frame
+//
+// Everything is kept in preallocated rings. A spike swaps the live rings with a spare set and the
+// spare is written by the app's BackgroundWriter, which also copies the stage timings out of the
+// profiler, so dumping costs the main loop almost nothing.
+// Off until enabled (j): the rings (~110MB, mostly raw depth) are only allocated the first time.
+
+#pragma once
+
+#ifndef JankDetector_hpp
+#define JankDetector_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include "ofMain.h"
+#include "Profiler.hpp"
+#include "FlowStats.hpp"
+#include "InputRecording.hpp"
+#include "BodyContourFinder.hpp"
+#include "BackgroundWriter.hpp"
+
+#endif /* JankDetector_hpp */
+
+
+class JankDetector{
+    
+public:
+    JankDetector();
+    
+    void setup(int depthWidth, int depthHeight, BackgroundWriter * writer = NULL);
+    
+    // main thread, in this order each frame
+    void beginFrame();                  // start of update: times the last frame, dumps if it was a spike
+    void recordKinect(const unsigned short * depth, const BodyContourFinder & contours);   // new kinect frames only
+    void recordFrame(const ParticleSystem & system, const FlowStats & flow, int contourVertices);
+    
+    void dump(const string & reason);   // also on demand (J)
+    int getSpikes();
+    
+    bool enabled;                       // allocates the rings the first frame it's on
+    float budgetMillis;                 // a frame longer than this is a spike
+    float cooldownSeconds;              // at most one dump per cooldown
+    int warmupFrames;                   // loading, the kinect starting up and the background learn aren't jank
+    
+    static const int historyFrames = 180;   // ~3s of app frames at 60fps
+    static const int kinectFrames = 90;     // ~3s of kinect frames at 30fps (~55MB of raw depth per ring, ~110MB for live + spare)
+    
+private:
+    struct Frame{
+        uint64_t frame;
+        uint64_t start;                 // micros, the update this was recorded in
+        float frameMillis;              // filled in at the start of the next one
+        int kinectIndex;                // sequence of the kinect frame that arrived this frame, or -1
+        FlowStats flow;
+        int contourVertices;
+        InputFrame inputs;
+    };
+    
+    struct KinectFrame{
+        int sequence;
+        uint64_t time;
+        vector<unsigned short> depth;
+        vector<ofPoint> points;
+        vector<int> counts;             // points per contour
+    };
+    
+    struct History{
+        vector<Frame> frames;
+        int frameNext, frameCount;
+        vector<KinectFrame> kinect;
+        int kinectNext, kinectCount;
+    };
+    
+    void allocate(History & h);
+    void write(string dir, uint64_t from, uint64_t to);
+    
+    History live, spare;                // spare belongs to the writer while it's busy
+    BackgroundWriter * writer;
+    int depthWidth, depthHeight;
+    int kinectSequence;
+    bool kinectNew;
+    uint64_t frameStart;
+    uint64_t lastDump;
+    int frames;
+    int spikes;
+    std::atomic<bool> writing;
+    
+};
@@ -0,0 +1,194 @@
+//
+//  LatencyTracker.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "LatencyTracker.hpp"
+
+static const char * inputNames[NUM_LATENCY_INPUTS] = { "body", "flow" };
+static const char * stageNames[NUM_LATENCY_STAGES] = { "cv", "wait", "sim", "render", "swap" };
+
+//--------------------------------------------------------------
+
+LatencyTracker::LatencyTracker(){
+    
+    bucketMillis = 2;
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        pending[i].valid = false;
+        inFlight[i].valid = false;
+        superseded[i] = 0;
+        samples[i].resize(windowSize);
+        next[i] = 0;
+        count[i] = 0;
+    }
+    
+    // sorted copies for the percentiles, sized once so the HUD doesn't allocate
+    scratch.reserve(windowSize);
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::handOff(LatencyInput input, uint64_t captureMicros, uint64_t cvDoneMicros){
+    
+    if(pending[input].valid) superseded[input]++;
+    Stamp & s = pending[input];
+    s.valid = true;
+    s.capture = captureMicros;
+    s.cvDone = cvDoneMicros;
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::beginSim(){
+    
+    uint64_t now = ofGetElapsedTimeMicros();
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        if(!pending[i].valid) continue;
+        inFlight[i] = pending[i];
+        inFlight[i].simBegin = now;
+        inFlight[i].simEnd = 0;
+        inFlight[i].renderEnd = 0;
+        pending[i].valid = false;
+    }
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::endSim(){
+    
+    uint64_t now = ofGetElapsedTimeMicros();
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        if(inFlight[i].valid && inFlight[i].simEnd == 0) inFlight[i].simEnd = now;
+    }
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::endRender(){
+    
+    uint64_t now = ofGetElapsedTimeMicros();
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        if(inFlight[i].valid && inFlight[i].simEnd != 0 && inFlight[i].renderEnd == 0) inFlight[i].renderEnd = now;
+    }
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::swapped(){
+    
+    // first light for whatever was drawn last frame
+    uint64_t now = ofGetElapsedTimeMicros();
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        if(!inFlight[i].valid || inFlight[i].renderEnd == 0) continue;
+        record((LatencyInput) i, inFlight[i], now);
+        inFlight[i].valid = false;
+    }
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::record(LatencyInput input, const Stamp & stamp, uint64_t now){
+    
+    Sample & s = samples[input][next[input]];
+    s.total = (now - stamp.capture) * 0.001;
+    s.stages[LATENCY_CV] = (stamp.cvDone - stamp.capture) * 0.001;
+    s.stages[LATENCY_WAIT] = (stamp.simBegin - stamp.cvDone) * 0.001;
+    s.stages[LATENCY_SIM] = (stamp.simEnd - stamp.simBegin) * 0.001;
+    s.stages[LATENCY_RENDER] = (stamp.renderEnd - stamp.simEnd) * 0.001;
+    s.stages[LATENCY_SWAP] = (now - stamp.renderEnd) * 0.001;
+    
+    next[input] = (next[input] + 1) % windowSize;
+    count[input] = min(count[input] + 1, (int) windowSize);
+}
+
+//--------------------------------------------------------------
+
+float LatencyTracker::getPercentile(LatencyInput input, float percentile){
+    
+    if(count[input] == 0) return 0;
+    scratch.clear();
+    for(int i = 0; i < count[input]; i++) scratch.push_back(samples[input][i].total);
+    int n = ofClamp(percentile * (count[input] - 1), 0, count[input] - 1);
+    std::nth_element(scratch.begin(), scratch.begin() + n, scratch.end());
+    return scratch[n];
+}
+
+//--------------------------------------------------------------
+
+float LatencyTracker::getStageMillis(LatencyInput input, LatencyStage stage){
+    
+    if(count[input] == 0) return 0;
+    float sum = 0;
+    for(int i = 0; i < count[input]; i++) sum += samples[input][i].stages[stage];
+    return sum / count[input];
+}
+
+//--------------------------------------------------------------
+
+int LatencyTracker::getSuperseded(LatencyInput input){
+    return superseded[input];
+}
+
+//--------------------------------------------------------------
+
+const char * LatencyTracker::getInputName(LatencyInput input){
+    return inputNames[input];
+}
+
+//--------------------------------------------------------------
+
+const char * LatencyTracker::getStageName(LatencyStage stage){
+    return stageNames[stage];
+}
+
+//--------------------------------------------------------------
+
+void LatencyTracker::draw(float x, float y){
+    
+    // one line per input: percentiles of the total and the mean of each stage, then both histograms overlaid
+    static const ofColor colors[NUM_LATENCY_INPUTS] = { ofColor(11, 186, 221), ofColor(252, 190, 17) };
+    float histTop = y + 28 + NUM_LATENCY_INPUTS * 14;
+    float histHeight = 80;
+    float barWidth = 454.0 / numBuckets;
+    
+    ofPushStyle();
+    ofSetColor(0, 0, 0, 180);
+    ofDrawRectangle(x, y, 470, histTop - y + histHeight + 24);
+    
+    ofSetColor(255);
+    ofDrawBitmapString("latency   p50    p95 ms   cv  wait   sim  rend  swap  lost", x + 8, y + 16);
+    char line[128];
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        LatencyInput input = (LatencyInput) i;
+        snprintf(line, sizeof(line), "%-6s %6.1f %6.1f    %5.1f %5.1f %5.1f %5.1f %5.1f %5d", inputNames[i],
+                 getPercentile(input, 0.5), getPercentile(input, 0.95),
+                 getStageMillis(input, LATENCY_CV), getStageMillis(input, LATENCY_WAIT), getStageMillis(input, LATENCY_SIM),
+                 getStageMillis(input, LATENCY_RENDER), getStageMillis(input, LATENCY_SWAP), superseded[i]);
+        ofSetColor(colors[i]);
+        ofDrawBitmapString(line, x + 8, y + 32 + i * 14);
+    }
+    
+    // the last bucket holds everything past the end
+    for(int i = 0; i < NUM_LATENCY_INPUTS; i++){
+        if(count[i] == 0) continue;
+        int buckets[numBuckets] = { 0 };
+        int highest = 1;
+        for(int s = 0; s < count[i]; s++){
+            int b = min((int) (samples[i][s].total / bucketMillis), numBuckets - 1);
+            highest = max(highest, ++buckets[b]);
+        }
+        ofSetColor(colors[i], 160);
+        for(int b = 0; b < numBuckets; b++){
+            float h = histHeight * buckets[b] / highest;
+            ofDrawRectangle(x + 8 + b * barWidth, histTop + histHeight - h, barWidth - 1, h);
+        }
+    }
+    
+    ofSetColor(255);
+    for(int ms = 0; ms < numBuckets * bucketMillis; ms += 20){
+        ofDrawBitmapString(ofToString(ms), x + 8 + ms / bucketMillis * barWidth, histTop + histHeight + 16);
+    }
+    ofPopStyle();
+}
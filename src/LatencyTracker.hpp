@@ -0,0 +1,90 @@
+//
+//  LatencyTracker.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Motion to photon latency. Each input frame's capture time travels with what's made from it
+// (the body outlines, the flow field via FlowResult) and is handed over with it to the particle system.
+// From there the tracker follows it through the next simulation step, the draw and the buffer swap,
+// and records the total plus a per stage breakdown. "Capture" is when the app picks the kinect frame
+// up; the sensor's exposure and USB transfer before that aren't seen here.
+
+#pragma once
+
+#ifndef LatencyTracker_hpp
+#define LatencyTracker_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* LatencyTracker_hpp */
+
+
+enum LatencyInput{
+    LATENCY_BODY,           // depth frame -> contours -> outlines
+    LATENCY_FLOW,           // colour frame -> flow worker -> flow field
+    NUM_LATENCY_INPUTS
+};
+
+enum LatencyStage{
+    LATENCY_CV,             // capture -> contours / flow done
+    LATENCY_WAIT,           // done -> the next particle update starts
+    LATENCY_SIM,            // particle update
+    LATENCY_RENDER,         // end of the update -> end of draw
+    LATENCY_SWAP,           // end of draw -> buffer swap returned (vsync and the frame rate limit included)
+    NUM_LATENCY_STAGES
+};
+
+
+class LatencyTracker{
+    
+public:
+    LatencyTracker();
+    
+    // an input made from the frame captured at captureMicros was given to the particle system
+    void handOff(LatencyInput input, uint64_t captureMicros, uint64_t cvDoneMicros);
+    
+    // the main loop, in order
+    void beginSim();
+    void endSim();
+    void endRender();
+    void swapped();
+    
+    // live histogram of the last windowSize totals and the mean of each stage
+    void draw(float x, float y);
+    
+    float getPercentile(LatencyInput input, float percentile);
+    float getStageMillis(LatencyInput input, LatencyStage stage);
+    int getSuperseded(LatencyInput input);  // handed over, then replaced before any update used them
+    static const char * getInputName(LatencyInput input);
+    static const char * getStageName(LatencyStage stage);
+    
+    static const int windowSize = 600;
+    static const int numBuckets = 60;
+    float bucketMillis;
+    
+private:
+    struct Stamp{
+        bool valid;
+        uint64_t capture, cvDone, simBegin, simEnd, renderEnd;
+    };
+    
+    struct Sample{
+        float total;
+        float stages[NUM_LATENCY_STAGES];
+    };
+    
+    void record(LatencyInput input, const Stamp & stamp, uint64_t now);
+    
+    Stamp pending[NUM_LATENCY_INPUTS];      // handed over, not simulated yet
+    Stamp inFlight[NUM_LATENCY_INPUTS];     // simulated this frame, waiting for the swap
+    int superseded[NUM_LATENCY_INPUTS];
+    
+    vector<Sample> samples[NUM_LATENCY_INPUTS];     // ring of windowSize
+    int next[NUM_LATENCY_INPUTS];
+    int count[NUM_LATENCY_INPUTS];
+    vector<float> scratch;
+    
+};
@@ -0,0 +1,158 @@
+//
+//  OneEuroContourFilter.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "OneEuroContourFilter.hpp"
+#include <cfloat>
+
+//--------------------------------------------------------------
+
+OneEuroContourFilter::OneEuroContourFilter(){
+    
+    numVertices = 120;
+    minCutoff = 1.0;
+    beta = 0.02;
+    dCutoff = 1.0;
+    initialised = false;
+}
+
+//--------------------------------------------------------------
+
+void OneEuroContourFilter::reset(){
+    initialised = false;
+}
+
+//--------------------------------------------------------------
+
+void OneEuroContourFilter::filter(const ofPolyline & in, float dt, ofPolyline & out){
+    
+    if(in.size() < 3){
+        out = in;
+        return;
+    }
+    
+    if(rawX.size() != numVertices) initialised = false;
+    
+    resample(in);
+    int n = numVertices;
+    
+    if(!initialised || dt <= 0){
+        filtX = rawX;
+        filtY = rawY;
+        speed.assign(n, 0);
+        initialised = true;
+    } else {
+        
+        // line the new vertices up with last frame's before filtering
+        int shift = findShift();
+        if(shift != 0){
+            std::rotate_copy(rawX.begin(), rawX.begin() + shift, rawX.end(), tmpX.begin());
+            std::rotate_copy(rawY.begin(), rawY.begin() + shift, rawY.end(), tmpY.begin());
+            rawX.swap(tmpX);
+            rawY.swap(tmpY);
+        }
+        
+        // alpha for a given cutoff: 1 / (1 + tau / dt) with tau = 1 / (2 pi cutoff)
+        float twoPiDt = TWO_PI * dt;
+        float alphaD = twoPiDt * dCutoff / (twoPiDt * dCutoff + 1);
+        
+        float * fx = filtX.data();
+        float * fy = filtY.data();
+        float * s = speed.data();
+        const float * rx = rawX.data();
+        const float * ry = rawY.data();
+        float invDt = 1. / dt;
+        
+        // no branches, no calls besides sqrt - this vectorises
+        for(int i = 0; i < n; i++){
+            float vx = (rx[i] - fx[i]) * invDt;
+            float vy = (ry[i] - fy[i]) * invDt;
+            float v = sqrtf(vx * vx + vy * vy);
+            s[i] += (v - s[i]) * alphaD;
+            
+            float cutoff = minCutoff + beta * s[i];
+            float alpha = twoPiDt * cutoff / (twoPiDt * cutoff + 1);
+            fx[i] += (rx[i] - fx[i]) * alpha;
+            fy[i] += (ry[i] - fy[i]) * alpha;
+        }
+    }
+    
+    out.resize(n);
+    for(int i = 0; i < n; i++){
+        out[i].set(filtX[i], filtY[i]);
+    }
+    out.setClosed(true);
+    out.flagHasChanged();
+}
+
+//--------------------------------------------------------------
+
+void OneEuroContourFilter::resample(const ofPolyline & in){
+    
+    int n = numVertices;
+    rawX.resize(n);
+    rawY.resize(n);
+    tmpX.resize(n);
+    tmpY.resize(n);
+    
+    const vector<ofPoint> & v = in.getVertices();
+    int m = v.size();
+    float perimeter = 0;
+    for(int i = 0; i < m; i++){
+        perimeter += v[i].distance(v[(i + 1) % m]);
+    }
+    
+    // walk the closed outline placing a vertex every perimeter / n
+    float spacing = perimeter / n;
+    float travelled = 0;
+    float nextTarget = 0;
+    int k = 0;
+    for(int i = 0; i < m && k < n; i++){
+        const ofPoint & a = v[i];
+        const ofPoint & b = v[(i + 1) % m];
+        float len = a.distance(b);
+        while(k < n && nextTarget <= travelled + len){
+            float t = len > 0 ? (nextTarget - travelled) / len : 0;
+            rawX[k] = a.x + (b.x - a.x) * t;
+            rawY[k] = a.y + (b.y - a.y) * t;
+            k++;
+            nextTarget = k * spacing;
+        }
+        travelled += len;
+    }
+    
+    // float rounding can leave the last one or two short
+    for(; k < n; k++){
+        rawX[k] = v[m - 1].x;
+        rawY[k] = v[m - 1].y;
+    }
+}
+
+//--------------------------------------------------------------
+
+int OneEuroContourFilter::findShift(){
+    
+    // the contour finder starts each outline wherever it first hits the body, so the same
+    // vertex index can land on a different bit of body each frame. try every rotation against
+    // last frame's filtered outline (on every 4th vertex, plenty for ~100 vertices) and keep the closest.
+    int n = numVertices;
+    int best = 0;
+    float bestDist = FLT_MAX;
+    for(int shift = 0; shift < n; shift++){
+        float d = 0;
+        for(int i = 0; i < n; i += 4){
+            int j = i + shift < n ? i + shift : i + shift - n;
+            float ex = rawX[j] - filtX[i];
+            float ey = rawY[j] - filtY[i];
+            d += ex * ex + ey * ey;
+        }
+        if(d < bestDist){
+            bestDist = d;
+            best = shift;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,49 @@
+//
+//  OneEuroContourFilter.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Temporal smoothing of a body outline with a One Euro filter (Casiez et al. 2012) per vertex.
+// The outline is first resampled to a fixed number of evenly spaced vertices and rotated to line up
+// with last frame's, so vertex i is the same bit of body from frame to frame.
+// Slow vertices get a low cutoff (jitter removed), fast ones a high cutoff (no lag when waving).
+
+#pragma once
+
+#ifndef OneEuroContourFilter_hpp
+#define OneEuroContourFilter_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* OneEuroContourFilter_hpp */
+
+
+class OneEuroContourFilter{
+    
+public:
+    OneEuroContourFilter();
+    
+    // dt is the time in seconds since the last outline was filtered
+    void filter(const ofPolyline & in, float dt, ofPolyline & out);
+    void reset();
+    
+    int numVertices;
+    float minCutoff;    // Hz, cutoff when still - lower = less jitter
+    float beta;         // how quickly the cutoff rises with speed - higher = less lag
+    float dCutoff;      // Hz, cutoff for the speed estimate
+    
+private:
+    void resample(const ofPolyline & in);
+    int findShift();
+    
+    // structure of arrays so the filter loop vectorises
+    vector<float> rawX, rawY;       // resampled input, rotated to match
+    vector<float> tmpX, tmpY;
+    vector<float> filtX, filtY;     // filtered positions
+    vector<float> speed;            // filtered speed (pixels / second)
+    bool initialised;
+    
+};
@@ -17,6 +17,7 @@ Particle::Particle(){
     maxSpeed = 5;
     maxForce = 5;
     mass = ofRandom(0.2, 4);
+    radius = 0;
     distMult = 1;
     c = ofColor(ofRandom(255), ofRandom(255), ofRandom(255));
     angle = ofDegToRad(ofRandom(0, 360));
@@ -111,10 +112,16 @@ void Particle::accelerateTowardsTarget(ofVec3f _target){
 // Wraparound when particles leave canvas
 
 void Particle::checkEdges() {
-    if (position.x < - radius) position.x = ofGetWidth() + radius;
-    if (position.y < - radius) position.y = ofGetHeight() + radius;
-    if (position.x > ofGetWidth() + radius) position.x = - radius;
-    if (position.y > ofGetHeight() + radius) position.y = - radius;
+    checkEdges(ofGetWidth(), ofGetHeight());
+}
+
+//--------------------------------------------------------------
+
+void Particle::checkEdges(float width, float height) {
+    if (position.x < - radius) position.x = width + radius;
+    if (position.y < - radius) position.y = height + radius;
+    if (position.x > width + radius) position.x = - radius;
+    if (position.y > height + radius) position.y = - radius;
 }
 
 //--------------------------------------------------------------
@@ -46,6 +46,7 @@ class Particle{
     void update();
     void draw();
     void checkEdges();
+    void checkEdges(float width, float height);   // same, with the screen size looked up once by the caller
     void applyForce(ofPoint force);
     void accelerateTowardsTarget(ofVec3f target);
     void getAngle(float a);
@@ -6,15 +6,40 @@
 //
 
 #include "ParticleSystem.hpp"
+#include <thread>
 
 //-------------------------------------------------------
 ParticleSystem::ParticleSystem()
 {
     modeCounter = 1;
     waveCounter = 0;
+    wavesPerMode = 4;
+    numBodies = 0;
+    numOfParticles = 0;
+    flowX = 0;
+    flowY = 0;
+    useFlowField = true;
+    numThreads = 1;
+    screenWidth = 0;
+    screenHeight = 0;
+    bodies.resize(maxBodies);
+    bodyCentroids.resize(maxBodies);
+    bodyTracked.assign(maxBodies, false);
+    followedBody.resize(maxBodies);
+    assignFollowedBodies();
+    poolGeneration = 0;
+    poolThreads = 1;
+    poolPending = 0;
+    poolExit = false;
+    poolP = 0;
 
 }
 
+//--------------------------------------------------------------
+ParticleSystem::~ParticleSystem(){
+    stopWorkers();
+}
+
 //--------------------------------------------------------------
 void ParticleSystem::setup(int _numOfParticles){
 
@@ -25,6 +50,90 @@ void ParticleSystem::setup(int _numOfParticles){
         Particle p;
         particles.push_back(p);
     }
+    
+    particleGroup.resize(numOfParticles);
+    particlePercent.resize(numOfParticles);
+    particleTargets.resize(numOfParticles);
+    groupStart.resize(maxBodies);
+    assignGroups();
+    
+    //one worker per spare core; update only starts more if numThreads asks for them
+    startWorkers(max(0, (int) std::thread::hardware_concurrency() - 1));
+}
+
+//--------------------------------------------------------------
+
+void ParticleSystem::startWorkers(int n){
+    
+    runBefore.resize(max<int>(runBefore.size(), n + 1));
+    while((int) workers.size() < n){
+        workers.push_back(std::thread(&ParticleSystem::workerLoop, this, (int) workers.size() + 1));
+    }
+}
+
+//--------------------------------------------------------------
+
+void ParticleSystem::stopWorkers(){
+    
+    {
+        std::lock_guard<std::mutex> lck(poolMutex);
+        poolExit = true;
+    }
+    poolWake.notify_all();
+    for (int t=0; t<workers.size(); t++) {
+        workers[t].join();
+    }
+    workers.clear();
+}
+
+//--------------------------------------------------------------
+
+//worker index runs range index of each frame that is split over more than index threads
+void ParticleSystem::workerLoop(int index){
+    
+    uint64_t seen = 0;
+    while(true){
+        int threads;
+        float p;
+        {
+            std::unique_lock<std::mutex> lck(poolMutex);
+            poolWake.wait(lck, [&]{ return poolExit || poolGeneration != seen; });
+            if(poolExit) return;
+            seen = poolGeneration;
+            threads = poolThreads;
+            p = poolP;
+        }
+        if(index >= threads) continue;
+        
+        int n = particles.size();
+        updateRange((n * index) / threads, (n * (index + 1)) / threads, p, runBefore[index]);
+        
+        std::lock_guard<std::mutex> lck(poolMutex);
+        if(--poolPending == 0) poolDone.notify_one();
+    }
+}
+
+//--------------------------------------------------------------
+
+// spread the particles evenly over the bodies, each group keeping its own 0-1 run along its outline.
+// only called when the number of bodies changes.
+void ParticleSystem::assignGroups(){
+    
+    int groups = max(numBodies, 1);
+    for (int g=0; g<groups; g++) {
+        groupStart[g] = (numOfParticles * g) / groups;
+    }
+    
+    //the group comes from groupStart itself, so every group's percents run 0 .. <1 in order
+    //(x * groups / numOfParticles rounds differently at the boundaries)
+    int g = 0;
+    for (int x=0; x<numOfParticles; x++) {
+        while (g + 1 < groups && x >= groupStart[g + 1]) g++;
+        int start = groupStart[g];
+        int end = g + 1 < groups ? groupStart[g + 1] : numOfParticles;
+        particleGroup[x] = g;
+        particlePercent[x] = float(x - start) / (end - start);
+    }
 }
 
 //--------------------------------------------------------------
@@ -33,22 +142,83 @@ void ParticleSystem::update(){
     //function taking care of mode changes
     changeMode();
     
-    //calculate blob centroid
-    cent = body.getCentroid2D();
+    //calculate blob centroids, once per body rather than once per particle.
+    //getPerimeter also builds the polyline's length cache, which getPointAtPercent would
+    //otherwise build lazily (and racily, with more than one thread)
+    int groups = max(numBodies, 1);
+    for (int g=0; g<groups; g++) {
+        bodyCentroids[g] = bodies[g].getCentroid2D();
+        bodies[g].getPerimeter();
+    }
+    cent = bodyCentroids[0];
+    
+    //every particle's point on its body, one walk along each outline instead of a search per particle
+    for (int g=0; g<groups; g++) {
+        int start = groupStart[g];
+        int end = g + 1 < groups ? groupStart[g + 1] : numOfParticles;
+        if(end > start) sampler.sample(bodies[followedBody[g]], &particlePercent[start], end - start, &particleTargets[start]);
+    }
     
     float p = ofMap(sin(step), -1, 1, 0, 1);
+    spacing = 1./numOfParticles;
+    edgeWidth = screenWidth > 0 ? screenWidth : ofGetWidth();
+    edgeHeight = screenHeight > 0 ? screenHeight : ofGetHeight();
     
-
-    for (int x=0; x<particles.size(); x++) {
+    //one contiguous run of particles per thread. Followers normally chase the particle before them
+    //as it is after this frame's update; the first particle of a run chases where its neighbour
+    //was at the start of the frame instead, so no thread reads another thread's particles.
+    int threads = ofClamp(numThreads, 1, max(1, (int) particles.size() / 1024));
+    if(threads == 1){
+        updateRange(0, particles.size(), p, ofPoint());
+    } else {
+        if((int) workers.size() < threads - 1) startWorkers(threads - 1);
+        
+        int n = particles.size();
+        for (int t=0; t<threads; t++) {
+            int first = (n * t) / threads;
+            runBefore[t] = first > 0 ? particles[first - 1].position : ofPoint();
+        }
         
-        spacing = 1./numOfParticles;
+        {
+            std::lock_guard<std::mutex> lck(poolMutex);
+            poolThreads = threads;
+            poolPending = threads - 1;
+            poolP = p;
+            poolGeneration++;
+        }
+        poolWake.notify_all();
+        updateRange(0, n / threads, p, runBefore[0]);
         
-        linePoint = body.getPointAtPercent(spacing * x);
+        std::unique_lock<std::mutex> lck(poolMutex);
+        poolDone.wait(lck, [&]{ return poolPending == 0; });
+    }
+    step+= 0.01;
+    
+}
+
+//--------------------------------------------------------------
+
+//the per particle part of update, for particles first .. last - 1.
+//before is the position of particle first - 1 at the start of the frame.
+void ParticleSystem::updateRange(int first, int last, float p, ofPoint before){
+    
+    for (int x=first; x<last; x++) {
+        
+        int group = particleGroup[x];
+        int followed = followedBody[group];
+        const ofPolyline & body = bodies[followed];
+        ofPoint linePoint = particleTargets[x];
     
         //These need to be run in all modes
-        particles[x].receiveFlow(flowX, flowY);
+        if(useFlowField){
+            float localX, localY;
+            flowField.sample(particles[x].position.x, particles[x].position.y, localX, localY);
+            particles[x].receiveFlow(localX, localY);
+        } else {
+            particles[x].receiveFlow(flowX, flowY);
+        }
         particles[x].update();
-        particles[x].checkEdges();
+        particles[x].checkEdges(edgeWidth, edgeHeight);
         
         
         // Main section for programming different behaviours in the modes
@@ -57,7 +227,6 @@ void ParticleSystem::update(){
             
             //get a point on the blob, and pull particle to the point
             
-            linePoint = body.getPointAtPercent(spacing * x);
             Attractor a(linePoint, 10);
             ofPoint force = a.attract(particles[x]);
             particles[x].applyForce(force);
@@ -69,7 +238,6 @@ void ParticleSystem::update(){
             //get a point on the blob, and accelerate to the point
 
             if(particles[x].velocity.x <= 0.3 && particles[x].velocity.y <= 0.3){
-                linePoint = body.getPointAtPercent(spacing * x);
                 particles[x].accelerateTowardsTarget(linePoint);
             
             }
@@ -79,8 +247,9 @@ void ParticleSystem::update(){
         if(followLeader){
             
             // Leader moves along the blob from beginning to end and back, other particles accelerate to the particle ahead of them
+            // (every body's group has its own leader)
             
-            if(x == 0){
+            if(x == groupStart[group]){
                 
                 if(followOnLine){
                     
@@ -89,10 +258,9 @@ void ParticleSystem::update(){
                 }
             }
             
-            if(x > 0){
-                linePoint = body.getPointAtPercent(spacing * x);
+            if(x > groupStart[group]){
                 ofPoint followLeader;
-                followLeader = (particles[x - 1].position);
+                followLeader = x == first ? before : particles[x - 1].position;
                 particles[x].accelerateTowardsTarget(followLeader);
             }
 
@@ -103,7 +271,7 @@ void ParticleSystem::update(){
             
             // gravitational force created at blob centroid, additional downward gravitational force comes and goes (sin).
             
-            ofPoint centroid = body.getCentroid2D();
+            ofPoint centroid = bodyCentroids[followed];
             Attractor a(centroid, 10);
             ofPoint force = a.attract(particles[x]);
             particles[x].applyForce(force);
@@ -114,8 +282,6 @@ void ParticleSystem::update(){
             
         }
     }
-    step+= 0.01;
-    
 }
 
 //--------------------------------------------------------------
@@ -137,7 +303,7 @@ void ParticleSystem::draw(){
         if(modeCounter == 2){
             
             spacing = 1./numOfParticles;
-            linePoint = body.getPointAtPercent(spacing * x);
+            linePoint = particleTargets[x];
             float dist = ofDist(linePoint.x, linePoint.y, particles[x].position.x, particles[x].position.y);
             float distMap = ofMap(dist, 0, 150, 0., 1., true);
             col1 = ofColor(53, 22, 229);
@@ -173,9 +339,74 @@ void ParticleSystem::draw(){
 //--------------------------------------------------------------
 
 //Function that receives the polyline "largestBlob" from ofApp.cpp
-void ParticleSystem::receivePoints(ofPolyline blob){
+void ParticleSystem::receivePoints(const ofPolyline & blob){
     body = blob;
+    setNumBodies(1);
+    bodies[0] = blob;
+    if(!bodyTracked[0]){
+        bodyTracked[0] = true;
+        assignFollowedBodies();
+    }
+    
+}
+//--------------------------------------------------------------
+
+//Number of tracked bodies this frame, particles are regrouped when it changes.
+//With 0 the particles keep following the last outline they had.
+void ParticleSystem::setNumBodies(int n){
+    
+    n = ofClamp(n, 0, maxBodies);
+    if(n == numBodies) return;
+    numBodies = n;
+    assignGroups();
+    assignFollowedBodies();
+}
+//--------------------------------------------------------------
+
+//Outline of one tracked body, copied into storage that is reused every frame
+void ParticleSystem::receiveBody(int group, const ofPolyline & outline){
+    
+    if(group < 0 || group >= maxBodies) return;
+    bodies[group] = outline;
+    if(group == 0) body = outline;
+    if(!bodyTracked[group]){
+        bodyTracked[group] = true;
+        assignFollowedBodies();
+    }
+}
+
+//--------------------------------------------------------------
+
+//The body in this slot has left. The slot keeps its particles (the groups only change with the
+//number of slots) but they follow a tracked body until someone takes the slot again.
+void ParticleSystem::releaseBody(int group){
+    
+    if(group < 0 || group >= maxBodies || !bodyTracked[group]) return;
+    bodyTracked[group] = false;
+    assignFollowedBodies();
+}
+
+//--------------------------------------------------------------
+
+int ParticleSystem::getFollowedBody(int group) const{
+    return followedBody[group];
+}
+
+//--------------------------------------------------------------
+
+//Empty slots are shared out over the tracked ones. With nobody tracked every group keeps
+//following its own last outline.
+void ParticleSystem::assignFollowedBodies(){
     
+    int groups = max(numBodies, 1);
+    int live[maxBodies];
+    int numLive = 0;
+    for (int g=0; g<groups; g++) {
+        if(bodyTracked[g]) live[numLive++] = g;
+    }
+    for (int g=0; g<maxBodies; g++) {
+        followedBody[g] = (g >= groups || bodyTracked[g] || numLive == 0) ? g : live[g % numLive];
+    }
 }
 //--------------------------------------------------------------
 void ParticleSystem::receiveFlow(float x, float y){
@@ -187,6 +418,14 @@ void ParticleSystem::receiveFlow(float x, float y){
 }
 //--------------------------------------------------------------
 
+//Coarse flow grid, already in screen space. The global flowX/flowY still drive the mode changes.
+void ParticleSystem::receiveFlowField(const FlowGrid & grid, const ofRectangle & screenRect){
+    
+    flowField = grid;
+    flowField.setScreenRect(screenRect);
+}
+//--------------------------------------------------------------
+
 //function used as keyboard shortcut for debugging
 void ParticleSystem::modeSwitch(){
     
@@ -207,12 +446,6 @@ void ParticleSystem::changeMode(){
         cout<<"MODE = " <<modeCounter<<endl;
     }
     
-    // listens for big changes in optical flow. After 10 big waves or movements, mode will change
-
-    if(flowX >= 3. || flowX <= -3.) waveCounter++;
-    if(waveCounter > 10)modeCounter ++;
-    if(waveCounter > 10 )waveCounter = 0;
-    
     // Using the various Bools, customise each mode!
     
     //Mode 1 = Follow leader along outline
@@ -263,6 +496,27 @@ void ParticleSystem::changeMode(){
 
 //--------------------------------------------------------------
 
+//Listens to the gesture detector. Every swing of a wave counts once (the old counter counted
+//frames, so one long swing could change the mode). Keeping still throws away a half finished wave.
+void ParticleSystem::onGesture(GestureEvent & e){
+    
+    if(e.type == GestureEvent::WAVE_LEFT || e.type == GestureEvent::WAVE_RIGHT){
+        waveCounter++;
+        if(waveCounter >= wavesPerMode){
+            waveCounter = 0;
+            modeCounter++;
+            if(modeCounter > 4) modeCounter = 1;
+            cout<<"MODE = " <<modeCounter<<endl;
+        }
+    }
+    
+    if(e.type == GestureEvent::STILLNESS){
+        waveCounter = 0;
+    }
+}
+
+//--------------------------------------------------------------
+
 //Function to be called in ofApp.cpp to send mode value out
 int ParticleSystem::getMode(){
     
@@ -11,10 +11,14 @@
 #define ParticleSystem_hpp
 
 #include <stdio.h>
+#include <condition_variable>
 #include "ofMain.h"
 #include "Particle.hpp"
 #include "Attractor.hpp"
 #include "ParameterSmoother.hpp"
+#include "FlowGrid.hpp"
+#include "GestureDetector.hpp"
+#include "ArcLengthSampler.hpp"
 #endif /* ParticleSystem_hpp */
 
 
@@ -23,18 +27,40 @@ class ParticleSystem{
 public:
     
     ParticleSystem();
+    ~ParticleSystem();
     void setup(int _numOfParticles);
     void update();
+    void updateRange(int first, int last, float p, ofPoint before);
     void draw();
-    void receivePoints(ofPolyline blob);
+    void receivePoints(const ofPolyline & blob);
+    void setNumBodies(int n);
+    void receiveBody(int group, const ofPolyline & outline);
+    void releaseBody(int group);                // nobody in that slot now, its particles follow someone who is
+    int getFollowedBody(int group) const;       // the body a group's particles follow
     void receiveFlow(float x, float y);
+    void receiveFlowField(const FlowGrid & grid, const ofRectangle & screenRect);
     void changeMode();
+    void onGesture(GestureEvent & e);
 
     vector <Particle> particles;
 
     int numOfParticles;
+    int numThreads;         // threads the per particle update is split over (1 = the original serial loop)
+    float screenWidth, screenHeight;    // what the particles wrap around, 0 = the window (the determinism harness fixes it)
     
     ofPolyline body;
+    
+    // particles are split into one contiguous group per tracked body.
+    // with no bodies everything follows bodies[0], the last outline received.
+    static const int maxBodies = 20;
+    vector <ofPolyline> bodies;
+    vector <bool> bodyTracked;      // set by receiveBody, cleared by releaseBody
+    vector <ofPoint> bodyCentroids;
+    int numBodies;
+    vector <int> particleGroup;     // which body each particle belongs to
+    vector <float> particlePercent; // where along its body each particle sits
+    vector <int> groupStart;        // first particle of each group (the leader)
+    vector <ofPoint> particleTargets; // each particle's point on its body this frame
     ofPoint linePoint;
     ofPoint cent;
 
@@ -45,6 +71,10 @@ public:
     float spacing;
     float flowX,flowY;
     
+    // local flow: each particle feels the motion under it instead of the global mean
+    FlowGrid flowField;
+    bool useFlowField;
+    
     bool centPull;
     void modeSwitch();
     bool followOnLine;
@@ -52,7 +82,8 @@ public:
     bool attractorPull;
 
     int modeCounter;
-    int waveCounter;
+    int waveCounter;        // swings since the last mode change
+    int wavesPerMode;
     
     ofColor col1;
     ofColor col2;
@@ -60,6 +91,29 @@ public:
     
     int getMode();
     
+private:
+    void assignGroups();
+    void assignFollowedBodies();
+    vector <int> followedBody;      // per group: itself while its body is tracked, otherwise a tracked one
+    vector <ofPoint> runBefore;
+    
+    // worker pool for the split update, started in setup and kept for the life of the system.
+    // each frame the main thread bumps the generation, runs the first range itself and waits
+    // for the workers that have a range this frame.
+    void startWorkers(int n);
+    void stopWorkers();
+    void workerLoop(int index);
+    vector <std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable poolWake, poolDone;
+    uint64_t poolGeneration;
+    int poolThreads;        // threads splitting the current frame, the main thread included
+    int poolPending;        // workers still running this frame
+    bool poolExit;
+    float poolP;
+    ArcLengthSampler sampler;
+    float edgeWidth, edgeHeight;
+    
     
   
     
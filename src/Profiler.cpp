@@ -0,0 +1,298 @@
+//
+//  Profiler.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "Profiler.hpp"
+
+bool Profiler::enabled = true;
+std::mutex Profiler::ringsMutex;
+vector<Profiler::ThreadRing *> Profiler::rings;
+ProfileSummary Profiler::summaries[NUM_PROFILE_STAGES];
+vector<ProfileSample> Profiler::scratch;
+vector<float> Profiler::durations[NUM_PROFILE_STAGES];
+uint64_t Profiler::lastCounterTotals[NUM_PROFILE_STAGES][NUM_HW_COUNTERS];
+
+static const char * stageNames[NUM_PROFILE_STAGES] = {
+    "kinect update",
+    "threshold",
+    "pyramid",
+    "find contours",
+    "polylines",
+    "optical flow",
+    "flow reduction",
+    "particles update",
+    "body fill",
+    "particles draw",
+    "swap"
+};
+
+//--------------------------------------------------------------
+
+Profiler::ThreadRing * Profiler::getRing(){
+    
+    // one ring per thread, made the first time that thread records anything.
+    // rings are never freed, a thread that ends just leaves its last samples behind.
+    static thread_local ThreadRing * ring = NULL;
+    if(ring) return ring;
+    
+    ring = new ThreadRing();
+    ring->head.store(0);
+    memset(ring->open, 0, sizeof(ring->open));
+    for(int s = 0; s < NUM_PROFILE_STAGES; s++){
+        ring->openTag[s] = -1;
+        ring->openCounts[s].valid = false;
+        for(int c = 0; c < NUM_HW_COUNTERS; c++) ring->counterTotals[s][c].store(0);
+    }
+    
+    std::lock_guard<std::mutex> lck(ringsMutex);
+    ring->name = "thread " + ofToString(rings.size());
+    rings.push_back(ring);
+    return ring;
+}
+
+//--------------------------------------------------------------
+
+void Profiler::setThreadName(const string & name){
+    
+    ThreadRing * ring = getRing();
+    std::lock_guard<std::mutex> lck(ringsMutex);
+    ring->name = name;
+}
+
+//--------------------------------------------------------------
+
+void Profiler::begin(ProfileStage stage){
+    
+    // the tag is kept even with profiling off, allocations are counted either way
+    ThreadRing * ring = getRing();
+    ring->openTag[stage] = AllocationTracker::getTag();
+    AllocationTracker::setTag(stage);
+    if(!enabled) return;
+    ring->openCounts[stage].valid = HardwareCounters::enabled && HardwareCounters::read(ring->openCounts[stage]);
+    ring->open[stage] = ofGetElapsedTimeMicros();
+}
+
+//--------------------------------------------------------------
+
+void Profiler::end(ProfileStage stage){
+    
+    ThreadRing * ring = getRing();
+    AllocationTracker::setTag(ring->openTag[stage]);
+    ring->openTag[stage] = -1;
+    if(!enabled) return;
+    if(ring->open[stage] == 0) return;
+    record(stage, ring->open[stage], ofGetElapsedTimeMicros());
+    ring->open[stage] = 0;
+    if(ring->openCounts[stage].valid) recordCounters(stage, ring->openCounts[stage]);
+    ring->openCounts[stage].valid = false;
+}
+
+//--------------------------------------------------------------
+
+void Profiler::record(ProfileStage stage, uint64_t start, uint64_t end){
+    
+    if(!enabled) return;
+    
+    // fill the slot, then publish it by moving head on
+    ThreadRing * ring = getRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ProfileSample & s = ring->samples[head & (ringSize - 1)];
+    s.start = start;
+    s.duration = end - start;
+    s.stage = stage;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void Profiler::recordCounters(ProfileStage stage, const HardwareCounts & start){
+    
+    if(!enabled) return;
+    HardwareCounts now;
+    if(!HardwareCounters::read(now)) return;
+    
+    // plain load and store, this thread is the only writer
+    ThreadRing * ring = getRing();
+    for(int c = 0; c < NUM_HW_COUNTERS; c++){
+        std::atomic<uint64_t> & total = ring->counterTotals[stage][c];
+        total.store(total.load(std::memory_order_relaxed) + (now.values[c] - start.values[c]), std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+int Profiler::copyRing(ThreadRing * ring, vector<ProfileSample> & out){
+    
+    // copy everything the ring holds, then drop whatever the writer could have
+    // overwritten while we were copying (it only ever moves forward). the writer
+    // stores into slot head before bumping head, so that slot may be half written too.
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t first = head > ringSize ? head - ringSize : 0;
+    
+    int base = out.size();
+    for(uint64_t i = first; i < head; i++){
+        out.push_back(ring->samples[i & (ringSize - 1)]);
+    }
+    
+    uint64_t after = ring->head.load(std::memory_order_acquire);
+    uint64_t safe = after + 1 > ringSize ? after + 1 - ringSize : 0;
+    if(safe > first){
+        int lapped = min<uint64_t>(safe - first, head - first);
+        out.erase(out.begin() + base, out.begin() + base + lapped);
+    }
+    return out.size() - base;
+}
+
+//--------------------------------------------------------------
+
+void Profiler::summarise(){
+    
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++) durations[i].clear();
+    
+    vector<ThreadRing *> list;
+    {
+        std::lock_guard<std::mutex> lck(ringsMutex);
+        list = rings;
+    }
+    
+    // counters: what every thread added since the last summarise, smoothed a little
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++){
+        for(int c = 0; c < NUM_HW_COUNTERS; c++){
+            uint64_t total = 0;
+            for(int r = 0; r < list.size(); r++) total += list[r]->counterTotals[i][c].load(std::memory_order_relaxed);
+            double frame = total - lastCounterTotals[i][c];
+            lastCounterTotals[i][c] = total;
+            summaries[i].counters[c] = summaries[i].counters[c] * 0.9 + frame * 0.1;
+        }
+    }
+    
+    // newest samples first, up to windowSize per stage over all threads
+    for(int r = 0; r < list.size(); r++){
+        scratch.clear();
+        copyRing(list[r], scratch);
+        for(int i = scratch.size() - 1; i >= 0; i--){
+            vector<float> & d = durations[scratch[i].stage];
+            if(d.size() < windowSize) d.push_back(scratch[i].duration * 0.001);
+        }
+    }
+    
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++){
+        vector<float> & d = durations[i];
+        ProfileSummary & s = summaries[i];
+        s.count = d.size();
+        if(d.empty()){
+            s.p50 = s.p95 = s.p99 = 0;
+            continue;
+        }
+        std::sort(d.begin(), d.end());
+        s.p50 = d[(d.size() - 1) * 50 / 100];
+        s.p95 = d[(d.size() - 1) * 95 / 100];
+        s.p99 = d[(d.size() - 1) * 99 / 100];
+    }
+}
+
+//--------------------------------------------------------------
+
+const ProfileSummary & Profiler::getSummary(ProfileStage stage){
+    return summaries[stage];
+}
+
+//--------------------------------------------------------------
+
+float Profiler::drawHud(float x, float y){
+    
+    // timings, then last frame's allocations (count and KB) for each stage,
+    // then the hardware counters per frame when they're on
+    int counterLines = HardwareCounters::enabled ? NUM_PROFILE_STAGES + 2 : 0;
+    float height = 28 + (NUM_PROFILE_STAGES + 2 + counterLines) * 14;
+    
+    ofPushStyle();
+    ofSetColor(0, 0, 0, 180);
+    ofDrawRectangle(x, y, 470, height);
+    
+    ofSetColor(255);
+    ofDrawBitmapString("stage                  p50    p95    p99 ms  allocs      KB", x + 8, y + 16);
+    char line[128];
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++){
+        const ProfileSummary & s = summaries[i];
+        const AllocationCounts & a = AllocationTracker::getFrameCounts(i);
+        snprintf(line, sizeof(line), "%-20s %6.2f %6.2f %6.2f %9llu %7.1f", stageNames[i], s.p50, s.p95, s.p99,
+                 (unsigned long long) a.allocations, a.bytes / 1024.0);
+        ofDrawBitmapString(line, x + 8, y + 32 + i * 14);
+    }
+    const AllocationCounts & other = AllocationTracker::getFrameCounts(AllocationTracker::untagged);
+    const AllocationCounts & total = AllocationTracker::getFrameTotal();
+    snprintf(line, sizeof(line), "%-41s %9llu %7.1f", "untagged", (unsigned long long) other.allocations, other.bytes / 1024.0);
+    ofDrawBitmapString(line, x + 8, y + 32 + NUM_PROFILE_STAGES * 14);
+    snprintf(line, sizeof(line), "%-41s %9llu %7.1f", AllocationTracker::strict ? "frame total (strict)" : "frame total",
+             (unsigned long long) total.allocations, total.bytes / 1024.0);
+    ofDrawBitmapString(line, x + 8, y + 32 + (NUM_PROFILE_STAGES + 1) * 14);
+    
+    if(counterLines > 0){
+        float top = y + 32 + (NUM_PROFILE_STAGES + 2) * 14;
+        string status = HardwareCounters::getStatus();
+        ofDrawBitmapString(status.empty() ? "per frame         Mcycles   IPC   L1D/ki  LLC/ki  br/ki" : "counters: " + status, x + 8, top);
+        for(int i = 0; status.empty() && i < NUM_PROFILE_STAGES; i++){
+            const double * c = summaries[i].counters;
+            double kiloInstructions = max(c[HW_INSTRUCTIONS] * 0.001, 0.001);
+            snprintf(line, sizeof(line), "%-16s %8.2f %5.2f %8.2f %7.2f %6.2f", stageNames[i], c[HW_CYCLES] * 0.000001,
+                     c[HW_CYCLES] > 0 ? c[HW_INSTRUCTIONS] / c[HW_CYCLES] : 0.0,
+                     c[HW_L1D_MISSES] / kiloInstructions, c[HW_LLC_MISSES] / kiloInstructions, c[HW_BRANCH_MISSES] / kiloInstructions);
+            ofDrawBitmapString(line, x + 8, top + 14 + i * 14);
+        }
+    }
+    ofPopStyle();
+    return height;
+}
+
+//--------------------------------------------------------------
+
+void Profiler::collect(vector<ProfileThread> & out){
+    
+    vector<ThreadRing *> list;
+    {
+        std::lock_guard<std::mutex> lck(ringsMutex);
+        list = rings;
+        out.resize(rings.size());
+        for(int r = 0; r < rings.size(); r++) out[r].name = rings[r]->name;
+    }
+    
+    for(int r = 0; r < list.size(); r++){
+        out[r].samples.clear();
+        copyRing(list[r], out[r].samples);
+    }
+}
+
+//--------------------------------------------------------------
+
+string Profiler::dumpCsv(){
+    
+    ofDirectory::createDirectory("profiles", true, true);
+    string path = "profiles/profile-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".csv";
+    ofstream csv(ofToDataPath(path).c_str());
+    csv << "thread,stage,start_us,duration_us" << endl;
+    
+    vector<ProfileThread> threads;
+    collect(threads);
+    
+    int written = 0;
+    for(int r = 0; r < threads.size(); r++){
+        const vector<ProfileSample> & samples = threads[r].samples;
+        for(int i = 0; i < samples.size(); i++){
+            csv << threads[r].name << "," << stageNames[samples[i].stage] << "," << samples[i].start << "," << samples[i].duration << "\n";
+        }
+        written += samples.size();
+    }
+    
+    ofLogNotice("Profiler") << "wrote " << written << " samples to " << path;
+    return path;
+}
+
+//--------------------------------------------------------------
+
+string Profiler::getStageName(int stage){
+    return stage >= 0 && stage < NUM_PROFILE_STAGES ? stageNames[stage] : "";
+}
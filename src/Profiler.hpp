@@ -0,0 +1,136 @@
+//
+//  Profiler.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Per-stage frame timing. Each thread writes its samples into its own ring buffer with a single
+// atomic store, no locks, so timing the flow worker costs the same as timing the main loop.
+// The main thread reads every ring to draw the HUD (rolling p50 / p95 / p99 per stage) and can
+// dump everything still in the rings to bin/data/profiles/*.csv.
+// With HardwareCounters::enabled each stage also reads the CPU counters either side, and the HUD shows
+// cycles, IPC and misses per thousand instructions: low IPC with many LLC misses is waiting on memory.
+//
+//     { ProfileScope scope(PROFILE_CONTOURS); ... }
+
+#pragma once
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include "ofMain.h"
+#include "AllocationTracker.hpp"
+#include "HardwareCounters.hpp"
+
+#endif /* Profiler_hpp */
+
+
+enum ProfileStage{
+    PROFILE_KINECT,
+    PROFILE_THRESHOLD,
+    PROFILE_PYRAMID,
+    PROFILE_CONTOURS,
+    PROFILE_POLYLINES,
+    PROFILE_FLOW,               // the flow engine itself (worker thread)
+    PROFILE_FLOW_STATS,         // reducing the field to stats + grid (worker thread)
+    PROFILE_PARTICLES_UPDATE,
+    PROFILE_BODY_FILL,
+    PROFILE_PARTICLES_DRAW,
+    PROFILE_SWAP,               // end of draw -> next update: buffer swap, vsync, events
+    NUM_PROFILE_STAGES
+};
+
+
+struct ProfileSample{
+    uint64_t start;             // ofGetElapsedTimeMicros
+    uint32_t duration;          // microseconds
+    int stage;
+};
+
+
+// everything one thread's ring still holds, oldest first
+struct ProfileThread{
+    string name;
+    vector<ProfileSample> samples;
+};
+
+
+struct ProfileSummary{
+    float p50, p95, p99;        // milliseconds
+    int count;
+    double counters[NUM_HW_COUNTERS];   // per frame, smoothed, over every thread
+};
+
+
+class Profiler{
+    
+public:
+    static const int ringSize = 16384;      // per thread, a power of two (~30s of the main loop)
+    static const int windowSize = 256;      // newest samples per stage the percentiles use
+    
+    // timing, from any thread
+    static void begin(ProfileStage stage);
+    static void end(ProfileStage stage);
+    static void record(ProfileStage stage, uint64_t start, uint64_t end);
+    static void recordCounters(ProfileStage stage, const HardwareCounts & start);
+    static void setThreadName(const string & name);
+    
+    // main thread
+    static void summarise();        // once per frame before drawHud / getSummary
+    static const ProfileSummary & getSummary(ProfileStage stage);
+    static float drawHud(float x, float y);     // returns its height
+    static string dumpCsv();        // returns the path written
+    static void collect(vector<ProfileThread> & out);
+    
+    static string getStageName(int stage);
+    static bool enabled;
+    
+private:
+    struct ThreadRing{
+        string name;
+        ProfileSample samples[ringSize];
+        std::atomic<uint64_t> head;     // total samples ever written, only the owning thread stores
+        uint64_t open[NUM_PROFILE_STAGES];
+        int openTag[NUM_PROFILE_STAGES];    // allocation tag before begin, put back by end
+        HardwareCounts openCounts[NUM_PROFILE_STAGES];
+        std::atomic<uint64_t> counterTotals[NUM_PROFILE_STAGES][NUM_HW_COUNTERS];     // only the owning thread adds
+    };
+    
+    static ThreadRing * getRing();
+    static int copyRing(ThreadRing * ring, vector<ProfileSample> & out);
+    
+    static std::mutex ringsMutex;       // only taken when a thread registers, and to list the rings
+    static vector<ThreadRing *> rings;
+    static ProfileSummary summaries[NUM_PROFILE_STAGES];
+    static vector<ProfileSample> scratch;
+    static vector<float> durations[NUM_PROFILE_STAGES];
+    static uint64_t lastCounterTotals[NUM_PROFILE_STAGES][NUM_HW_COUNTERS];
+    
+};
+
+
+// times the enclosing block, and counts its allocations against the stage
+class ProfileScope{
+    
+public:
+    ProfileScope(ProfileStage _stage) : stage(_stage), previousTag(AllocationTracker::getTag()) {
+        AllocationTracker::setTag(stage);
+        counters.valid = HardwareCounters::enabled && HardwareCounters::read(counters);
+        start = ofGetElapsedTimeMicros();
+    }
+    ~ProfileScope(){
+        Profiler::record(stage, start, ofGetElapsedTimeMicros());
+        if(counters.valid) Profiler::recordCounters(stage, counters);
+        AllocationTracker::setTag(previousTag);
+    }
+    
+private:
+    ProfileStage stage;
+    int previousTag;
+    uint64_t start;
+    HardwareCounts counters;
+    
+};
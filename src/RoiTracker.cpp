@@ -0,0 +1,120 @@
+//
+//  RoiTracker.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "RoiTracker.hpp"
+
+//--------------------------------------------------------------
+
+RoiTracker::RoiTracker(){
+    
+    margin = 40;
+    fullScanInterval = 30;
+    width = 0;
+    height = 0;
+    hasBounds = false;
+    framesSinceFullScan = 0;
+}
+
+//--------------------------------------------------------------
+
+void RoiTracker::setup(int _width, int _height){
+    
+    width = _width;
+    height = _height;
+    roi.set(0, 0, width, height);
+    hasBounds = false;
+    framesSinceFullScan = 0;
+}
+
+//--------------------------------------------------------------
+
+ofRectangle RoiTracker::getRoi(){
+    return roi;
+}
+
+//--------------------------------------------------------------
+
+bool RoiTracker::isFullFrame(){
+    return roi.width >= width && roi.height >= height;
+}
+
+//--------------------------------------------------------------
+
+void RoiTracker::update(const vector<ofRectangle> & found){
+    
+    framesSinceFullScan = isFullFrame() ? 0 : framesSinceFullScan + 1;
+    
+    // nothing there - go back to looking everywhere
+    if(found.empty()){
+        hasBounds = false;
+        velocity.set(0, 0);
+        roi.set(0, 0, width, height);
+        return;
+    }
+    
+    ofRectangle bounds = found[0];
+    for(int i = 1; i < found.size(); i++){
+        bounds.growToInclude(found[i]);
+    }
+    
+    // constant velocity prediction of the bounds' centre, smoothed a little so one noisy frame
+    // doesn't throw the window off
+    if(hasBounds){
+        ofPoint delta = bounds.getCenter() - lastBounds.getCenter();
+        velocity = velocity * 0.5 + delta * 0.5;
+    }
+    lastBounds = bounds;
+    hasBounds = true;
+    
+    if(framesSinceFullScan >= fullScanInterval){
+        roi.set(0, 0, width, height);
+        return;
+    }
+    
+    // grow by the margin plus however far the body moved, so fast moves stay inside
+    float growX = margin + fabs(velocity.x);
+    float growY = margin + fabs(velocity.y);
+    roi.set(bounds.x + velocity.x - growX,
+            bounds.y + velocity.y - growY,
+            bounds.width + growX * 2,
+            bounds.height + growY * 2);
+    clampToImage(roi);
+}
+
+//--------------------------------------------------------------
+
+ofRectangle RoiTracker::getScaledRoi(float scale, bool mirror){
+    
+    ofRectangle r = roi;
+    if(mirror){
+        r.x = width - r.x - r.width;
+    }
+    
+    // round outwards so the scaled region never loses an edge pixel
+    float x0 = floor(r.x * scale);
+    float y0 = floor(r.y * scale);
+    float x1 = ceil((r.x + r.width) * scale);
+    float y1 = ceil((r.y + r.height) * scale);
+    r.set(x0, y0, x1 - x0, y1 - y0);
+    
+    r.x = ofClamp(r.x, 0, floor(width * scale));
+    r.y = ofClamp(r.y, 0, floor(height * scale));
+    r.width = ofClamp(r.width, 0, floor(width * scale) - r.x);
+    r.height = ofClamp(r.height, 0, floor(height * scale) - r.y);
+    return r;
+}
+
+//--------------------------------------------------------------
+
+void RoiTracker::clampToImage(ofRectangle & r){
+    
+    float x0 = ofClamp(floor(r.x), 0, width);
+    float y0 = ofClamp(floor(r.y), 0, height);
+    float x1 = ofClamp(ceil(r.x + r.width), 0, width);
+    float y1 = ofClamp(ceil(r.y + r.height), 0, height);
+    r.set(x0, y0, x1 - x0, y1 - y0);
+}
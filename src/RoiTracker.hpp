@@ -0,0 +1,54 @@
+//
+//  RoiTracker.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Predicts where the body will be next frame from where it was last frame, so contour finding,
+// mask cleanup and optical flow only have to look at that part of the image.
+// Every fullScanInterval frames (or whenever nothing was found) the whole frame is scanned
+// again so new visitors walking in are picked up.
+
+#pragma once
+
+#ifndef RoiTracker_hpp
+#define RoiTracker_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+
+#endif /* RoiTracker_hpp */
+
+
+class RoiTracker{
+    
+public:
+    RoiTracker();
+    
+    void setup(int _width, int _height);
+    
+    // region to process this frame, in whole pixels and inside the image
+    ofRectangle getRoi();
+    bool isFullFrame();
+    
+    // call once per new frame with the bounds of everything found inside getRoi()
+    void update(const vector<ofRectangle> & found);
+    
+    // same region, for an image scaled by 'scale' and optionally flipped horizontally
+    ofRectangle getScaledRoi(float scale, bool mirror);
+    
+    int margin;             // pixels added around the predicted bounds
+    int fullScanInterval;   // frames between full-frame scans
+    
+private:
+    void clampToImage(ofRectangle & r);
+    
+    int width, height;
+    ofRectangle roi;
+    ofRectangle lastBounds;
+    ofPoint velocity;
+    bool hasBounds;
+    int framesSinceFullScan;
+    
+};
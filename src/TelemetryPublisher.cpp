@@ -0,0 +1,187 @@
+//
+//  TelemetryPublisher.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "TelemetryPublisher.hpp"
+
+//--------------------------------------------------------------
+
+TelemetryPublisher::TelemetryPublisher(){
+    
+    host = "127.0.0.1";
+    port = 9000;
+    rate = 2;
+    name = "magnets";
+    enabled = true;
+    hasPending = false;
+    nextDue = 0;
+    lastSent = 0;
+}
+
+//--------------------------------------------------------------
+
+TelemetryPublisher::~TelemetryPublisher(){
+    stop();
+}
+
+//--------------------------------------------------------------
+
+void TelemetryPublisher::setup(const string & settingsPath){
+    
+    ifstream settings(ofToDataPath(settingsPath).c_str());
+    string line;
+    while(getline(settings, line)){
+        vector<string> words = ofSplitString(line, " ", true, true);
+        if(words.size() < 2 || words[0][0] == '#') continue;
+        if(words[0] == "host") host = words[1];
+        else if(words[0] == "port") port = ofToInt(words[1]);
+        else if(words[0] == "rate") rate = ofToFloat(words[1]);
+        else if(words[0] == "name") name = words[1];
+        else if(words[0] == "enabled") enabled = ofToInt(words[1]) != 0;
+    }
+    
+    if(!enabled || rate <= 0) return;
+    ofLogNotice("TelemetryPublisher") << "sending /fixative/" << name << " to " << host << ":" << port << ", " << rate << " bundles a second";
+    lastSent = ofGetElapsedTimeMicros();
+    nextDue = lastSent + uint64_t(1000000 / rate);
+    startThread();
+}
+
+//--------------------------------------------------------------
+
+void TelemetryPublisher::stop(){
+    
+    if(!isThreadRunning()) return;
+    stopThread();
+    
+    // same as FlowWorker: with the lock taken the thread is either waiting or will see the flag
+    { std::lock_guard<std::mutex> lck(mutex); }
+    wake.notify_all();
+    waitForThread(false);
+}
+
+//--------------------------------------------------------------
+
+bool TelemetryPublisher::isDue(){
+    return isThreadRunning() && ofGetElapsedTimeMicros() >= nextDue.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void TelemetryPublisher::publish(const TelemetryFrame & frame){
+    
+    // the next one is due a period from now, however late this one was
+    nextDue = ofGetElapsedTimeMicros() + uint64_t(1000000 / rate);
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        pending = frame;
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+//--------------------------------------------------------------
+
+void TelemetryPublisher::threadedFunction(){
+    
+    Profiler::setThreadName("telemetry");
+    sender.setup(host, port);
+    
+    while(isThreadRunning()){
+        TelemetryFrame frame;
+        {
+            std::unique_lock<std::mutex> lck(mutex);
+            wake.wait(lck, [this]{ return hasPending || !isThreadRunning(); });
+            if(!hasPending) break;
+            frame = pending;
+            hasPending = false;
+        }
+        
+        uint64_t now = ofGetElapsedTimeMicros();
+        send(frame, lastSent, now);
+        lastSent = now;
+    }
+}
+
+//--------------------------------------------------------------
+
+void TelemetryPublisher::send(const TelemetryFrame & frame, uint64_t from, uint64_t to){
+    
+    string prefix = "/fixative/" + name;
+    bundle.clear();
+    ofxOscMessage m;
+    
+    m.setAddress(prefix + "/fps");
+    m.addFloatArg(frame.fps);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/frame");
+    m.addIntArg(frame.frame);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/mode");
+    m.addIntArg(frame.mode);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/particles");
+    m.addIntArg(frame.particles);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/blobs");
+    m.addIntArg(frame.blobs);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/contourVertices");
+    m.addIntArg(frame.contourVertices);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/flow");
+    m.addFloatArg(frame.flow.meanX);
+    m.addFloatArg(frame.flow.meanY);
+    m.addFloatArg(frame.flow.medianX);
+    m.addFloatArg(frame.flow.medianY);
+    m.addFloatArg(frame.flow.movingFraction);
+    m.addFloatArg(frame.flow.dominantDirection);
+    m.addFloatArg(frame.flow.dominantStrength);
+    bundle.addMessage(m);
+    
+    m.clear();
+    m.setAddress(prefix + "/allocations");
+    m.addIntArg(frame.allocations);
+    m.addIntArg(frame.allocatedBytes / 1024);
+    bundle.addMessage(m);
+    
+    // stage timings since the last bundle, from every thread's ring
+    Profiler::collect(threads);
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++) durations[i].clear();
+    for(int t = 0; t < threads.size(); t++){
+        const vector<ProfileSample> & samples = threads[t].samples;
+        for(int s = 0; s < samples.size(); s++){
+            if(samples[s].start >= from && samples[s].start < to) durations[samples[s].stage].push_back(samples[s].duration * 0.001);
+        }
+    }
+    
+    for(int i = 0; i < NUM_PROFILE_STAGES; i++){
+        vector<float> & d = durations[i];
+        if(d.empty()) continue;
+        std::sort(d.begin(), d.end());
+        m.clear();
+        m.setAddress(prefix + "/stage");
+        m.addStringArg(Profiler::getStageName(i));
+        m.addFloatArg(d[(d.size() - 1) * 50 / 100]);
+        m.addFloatArg(d[(d.size() - 1) * 95 / 100]);
+        m.addIntArg(d.size());
+        bundle.addMessage(m);
+    }
+    
+    sender.sendBundle(bundle);
+}
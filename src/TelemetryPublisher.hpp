@@ -0,0 +1,86 @@
+//
+//  TelemetryPublisher.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Sends live performance numbers to the venue monitoring over OSC, a few times a second rather
+// than every frame. The main thread only copies a handful of numbers when a send is due; the
+// stage timings are read straight from the profiler rings, and the bundle is built and sent,
+// on the publisher's own thread. Every address starts with /fixative/<name> so several
+// installations can report to the same listener:
+//
+//     /fps f   /frame i   /mode i   /particles i   /blobs i   /contourVertices i
+//     /flow fffffff           mean x y, median x y, moving fraction, dominant direction and strength
+//     /allocations ii         last frame's allocation count and KB
+//     /stage sffi             per stage: name, p50 and p95 ms since the last bundle, sample count
+//
+// Settings come from bin/data/telemetry.txt if there is one ("host 10.0.0.5", "port 9000", "rate 2", "name foyer").
+
+#pragma once
+
+#ifndef TelemetryPublisher_hpp
+#define TelemetryPublisher_hpp
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "Profiler.hpp"
+#include "FlowStats.hpp"
+
+#endif /* TelemetryPublisher_hpp */
+
+
+// what the main thread hands over
+struct TelemetryFrame{
+    float fps;
+    uint64_t frame;
+    int mode;
+    int particles;
+    int blobs;
+    int contourVertices;
+    FlowStats flow;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+
+
+class TelemetryPublisher : public ofThread{
+    
+public:
+    TelemetryPublisher();
+    ~TelemetryPublisher();
+    
+    void setup(const string & settingsPath = "telemetry.txt");
+    void stop();
+    
+    // main thread: a cheap time check, then publish if it says so
+    bool isDue();
+    void publish(const TelemetryFrame & frame);
+    
+    string host;
+    int port;
+    float rate;                     // bundles per second
+    string name;
+    bool enabled;
+    
+private:
+    void threadedFunction();
+    void send(const TelemetryFrame & frame, uint64_t from, uint64_t to);
+    
+    ofxOscSender sender;            // only touched by the publisher thread
+    ofxOscBundle bundle;
+    
+    TelemetryFrame pending;         // shared, under the lock
+    bool hasPending;
+    std::condition_variable wake;
+    std::atomic<uint64_t> nextDue;
+    
+    vector<ProfileThread> threads;
+    vector<float> durations[NUM_PROFILE_STAGES];
+    uint64_t lastSent;
+    
+};
@@ -0,0 +1,136 @@
+//
+//  TraceRecorder.cpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+#include "TraceRecorder.hpp"
+
+static const char * counterNames[NUM_TRACE_COUNTERS] = {
+    "particles",
+    "blobs",
+    "contour vertices"
+};
+
+//--------------------------------------------------------------
+
+TraceRecorder::TraceRecorder(){
+    
+    memset(current, 0, sizeof(current));
+    historyCount = 0;
+    historyNext = 0;
+    capturing = false;
+    captureFrom = 0;
+    captureTo = 0;
+    writer = NULL;
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::setup(BackgroundWriter * _writer){
+    writer = _writer;
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::setCounter(TraceCounter counter, float value){
+    current[counter] = value;
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::update(){
+    
+    // one counter sample per frame
+    CounterFrame & f = history[historyNext];
+    f.time = ofGetElapsedTimeMicros();
+    memcpy(f.values, current, sizeof(current));
+    historyNext = (historyNext + 1) % historySize;
+    historyCount = min(historyCount + 1, historySize);
+    
+    if(capturing && f.time >= captureTo){
+        capturing = false;
+        save(captureFrom, captureTo);
+    }
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::saveLast(float seconds){
+    
+    uint64_t now = ofGetElapsedTimeMicros();
+    uint64_t window = seconds * 1000000;
+    save(now > window ? now - window : 0, now);
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::trigger(float seconds){
+    
+    if(capturing) return;
+    capturing = true;
+    captureFrom = ofGetElapsedTimeMicros();
+    captureTo = captureFrom + uint64_t(seconds * 1000000);
+    ofLogNotice("TraceRecorder") << "capturing the next " << seconds << "s";
+}
+
+//--------------------------------------------------------------
+
+bool TraceRecorder::isCapturing(){
+    return capturing;
+}
+
+//--------------------------------------------------------------
+
+void TraceRecorder::save(uint64_t from, uint64_t to){
+    
+    // grab everything now, on the main thread (cheap copies), format and write it on another one
+    vector<ProfileThread> threads;
+    Profiler::collect(threads);
+    
+    vector<CounterFrame> counters;
+    for(int i = 0; i < historyCount; i++){
+        const CounterFrame & f = history[(historyNext - historyCount + i + historySize) % historySize];
+        if(f.time >= from && f.time <= to) counters.push_back(f);
+    }
+    
+    ofDirectory::createDirectory("traces", true, true);
+    string path = ofToDataPath("traces/trace-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json");
+    
+    // saves queue up on the writer, one trace at a time
+    std::function<void()> job = [threads, counters, from, to, path](){
+        
+        ofstream json(path.c_str());
+        json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        json << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"magnetsKinect\"}}";
+        
+        int written = 0;
+        for(int t = 0; t < threads.size(); t++){
+            json << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+                 << ", \"args\": {\"name\": \"" << threads[t].name << "\"}}";
+            
+            // complete events: a begin and an end per stage in one record
+            const vector<ProfileSample> & samples = threads[t].samples;
+            for(int i = 0; i < samples.size(); i++){
+                const ProfileSample & s = samples[i];
+                if(s.start + s.duration < from || s.start > to) continue;
+                json << ",\n{\"name\": \"" << Profiler::getStageName(s.stage) << "\", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t
+                     << ", \"ts\": " << s.start << ", \"dur\": " << s.duration << "}";
+                written++;
+            }
+        }
+        
+        for(int i = 0; i < counters.size(); i++){
+            for(int c = 0; c < NUM_TRACE_COUNTERS; c++){
+                json << ",\n{\"name\": \"" << counterNames[c] << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << counters[i].time
+                     << ", \"args\": {\"value\": " << counters[i].values[c] << "}}";
+            }
+        }
+        
+        json << "\n]}\n";
+        ofLogNotice("TraceRecorder") << "wrote " << written << " stage events and " << counters.size() << " counter frames to " << path;
+    };
+    if(writer) writer->add(job);
+    else job();
+}
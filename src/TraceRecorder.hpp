@@ -0,0 +1,69 @@
+//
+//  TraceRecorder.hpp
+//  magnetsKinect
+//
+//  Created by agent on 19/10/26.
+//
+
+// Writes the profiler's stage timings as Chrome Trace Event JSON (opens in chrome://tracing and
+// ui.perfetto.dev), one track per thread, plus counter tracks for particles, blobs and contour
+// vertices. Either the last few seconds on demand, or a triggered capture of the next few seconds.
+// The stage samples come straight out of the Profiler rings; only the counters are kept here.
+// Files go to bin/data/traces/ and are written by the app's BackgroundWriter.
+
+#pragma once
+
+#ifndef TraceRecorder_hpp
+#define TraceRecorder_hpp
+
+#include <stdio.h>
+#include "ofMain.h"
+#include "Profiler.hpp"
+#include "BackgroundWriter.hpp"
+
+#endif /* TraceRecorder_hpp */
+
+
+enum TraceCounter{
+    TRACE_PARTICLES,
+    TRACE_BLOBS,
+    TRACE_CONTOUR_VERTICES,
+    NUM_TRACE_COUNTERS
+};
+
+
+class TraceRecorder{
+    
+public:
+    TraceRecorder();
+    
+    void setup(BackgroundWriter * writer);
+    
+    // main thread, once per frame
+    void setCounter(TraceCounter counter, float value);
+    void update();
+    
+    void saveLast(float seconds);       // what happened up to now
+    void trigger(float seconds);        // what happens from now on, saved when it's over
+    bool isCapturing();
+    
+    static const int historySize = 2048;    // frames of counters (~30s at 60fps, like the profiler rings)
+    
+private:
+    struct CounterFrame{
+        uint64_t time;
+        float values[NUM_TRACE_COUNTERS];
+    };
+    
+    void save(uint64_t from, uint64_t to);
+    
+    float current[NUM_TRACE_COUNTERS];
+    CounterFrame history[historySize];
+    int historyCount;
+    int historyNext;
+    
+    bool capturing;
+    uint64_t captureFrom, captureTo;
+    
+    BackgroundWriter * writer;          // NULL writes on the calling thread
+};
@@ -4,7 +4,7 @@
  
  A program that explores forces through interaction. Uses computer vision (kinect depth image) to isolate a body in the image, facilitating communication
  between small particles/shapes and a human player. Different modes of behaviour are triggered after periods of interaction. After a certain number of
- large waves or strong motions (currently 10) the program will move to the next mode.
+ waves (currently 4 swings, left or right) the program will move to the next mode; keeping still for a couple of seconds resets the count.
 
  Optical Flow from the video acts as another interactive force.
  
@@ -74,18 +74,52 @@ void ofApp::setup() {
 	grayImage.allocate(kinect.width, kinect.height);
 	grayThreshNear.allocate(kinect.width, kinect.height);
 	grayThreshFar.allocate(kinect.width, kinect.height);
+    roiTracker.setup(kinect.width, kinect.height);
+    bodyContours.setup(kinect.width, kinect.height);
+    pyramid.setup(kinect.width, kinect.height);
+    debugMaskTexture.allocate(kinect.width / 2, kinect.height / 2, GL_LUMINANCE);
+    contourLevel = 0;
+    flowLevel = 2;
+    pyramid.luminanceLevel = flowLevel;
+    flowWorker.setup(kinect.width, kinect.height, FramePyramid::getScale(flowLevel));
+    writer.setup();
+    traceRecorder.setup(&writer);
+    jankDetector.setup(kinect.width, kinect.height, &writer);
+    telemetry.setup();
+    avgX = 0;
+    avgY = 0;
+    renderVertexBudget = 400;
+    physicsVertexBudget = 120;
+    
+    //screen placement of the body outline
+    bodyOffset.set(180, 50);
+    bodyScale = 1;
+    lastContourTime = 0;
 	
 	nearThreshold = 208;
 	farThreshold = 160;
 	bThreshWithOpenCV = true;
+    bRawDepth = true;
+    
+    // learn the empty room for the first few seconds (press b to relearn when the space is clear)
+    depthSegmenter.learnBackground(90);
 	ofSetFrameRate(60);
 	
 	// set the tilt on startup
 	angle = 9;
 	kinect.setCameraTiltAngle(angle);
 	
+    Profiler::setThreadName("main");
+    showProfiler = false;
+    showLatency = false;
+    frameCaptureMicros = 0;
+    contoursDoneMicros = 0;
+    
     //setup particle system with 100 particles
     system.setup(100);
+    
+    //mode changes come from gestures, not from polling the flow every frame
+    ofAddListener(gestures.gestureEvent, &system, &ParticleSystem::onGesture);
 
     debug = false;
     
@@ -99,16 +133,40 @@ void ofApp::setup() {
 //--------------------------------------------------------------
 void ofApp::update() {
     
+    //everything since the end of the last draw: buffer swap, vsync, events
+    Profiler::end(PROFILE_SWAP);
+    AllocationTracker::frame();
+    latency.swapped();
+    jankDetector.beginFrame();
+    
     //function that recieves the 'mode' from ParticleSystem.
     mode = system.getMode();
   
     //update for kinect
     
-	kinect.update();
+    {
+        ProfileScope scope(PROFILE_KINECT);
+        kinect.update();
+    }
 	
 	// there is a new frame and we are connected
 	if(kinect.isFrameNew()) {
 		
+        frameCaptureMicros = ofGetElapsedTimeMicros();
+        Profiler::begin(PROFILE_THRESHOLD);
+        if(bRawDepth) {
+            
+            // band-pass the raw millimetre depth straight into grayImage's buffer, mirrored in the same pass.
+            // no 8 bit conversion, no extra copies, thresholds stay the same between venues.
+            IplImage * mask = grayImage.getCvImage();
+            depthSegmenter.clearBodies();
+            for(int t = 0; t < blobTracker.tracks.size(); t++){
+                depthSegmenter.addBody(blobTracker.tracks[t].bounds);
+            }
+            depthSegmenter.segment(kinect.getRawDepthPixels(), (unsigned char *) mask->imageData, mask->widthStep, true);
+            
+        } else {
+        
 		// load grayscale depth image from the kinect source
 		grayImage.setFromPixels(kinect.getDepthPixels());
         grayImage.mirror(false, true);
@@ -134,25 +192,59 @@ void ofApp::update() {
 				}
 			}
 		}
+            
+        }
 		
+        // everything from here on only looks at the region the body is predicted to be in.
+        // every so often this is the whole frame, to pick up anyone new walking in.
+        contourRoi = roiTracker.getRoi();
+        cv::Rect roiRect(contourRoi.x, contourRoi.y, contourRoi.width, contourRoi.height);
+        
+        // clean up speckle on the depth edges, in place, inside the roi only
+        Mat mask(grayImage.getCvImage());
+        Mat maskRoi = mask(roiRect);
+        morphologyEx(maskRoi, maskRoi, MORPH_OPEN, Mat());
+        
 		// update the cv images
 		grayImage.flagImageChanged();
+        Profiler::end(PROFILE_THRESHOLD);
+        
+        // the finished mask at full, 1/2 and 1/4 size and the colour frame's luminance at the
+        // flow's size, shared by contours, flow and the debug view
+        {
+            ProfileScope scope(PROFILE_PYRAMID);
+            pyramid.build(mask, kinect.getPixels());
+        }
         
 		// find contours
-		//find holes set to false
-		contourFinder.findContours(grayImage, 2000, (kinect.width*kinect.height)/2, 20, false);
-        //Store objects' centers
-        blobs = contourFinder.blobs;
+		//outer contours only, straight from the mask level into one flat point buffer (always full resolution coordinates)
+        {
+            ProfileScope scope(PROFILE_CONTOURS);
+            bodyContours.findContours(pyramid.getMask(contourLevel), contourRoi, FramePyramid::getScale(contourLevel));
+        }
         
         //Fill vector of polylines with points from all of the detected blobs.
-        polylines.clear();
-        for (int i=0; i<blobs.size(); i++){
-            vector <ofPoint> blobPoints = blobs[i].pts;
-            ofPolyline tempPolyline;
-            tempPolyline.addVertices(blobPoints);
-            tempPolyline.getResampledBySpacing(50);
-            polylines.push_back(tempPolyline);
+        //each contour is simplified to a fixed vertex budget: a fine outline for drawing the body
+        //and a coarse one for the particle physics, so per-vertex work downstream is bounded.
+        //the polylines are reused frame to frame, so their vertex storage is too
+        Profiler::begin(PROFILE_POLYLINES);
+        polylines.resize(bodyContours.size());
+        coarsePolylines.resize(bodyContours.size());
+        foundBounds.clear();
+        for (int i=0; i<bodyContours.size(); i++){
+            foundBounds.push_back(bodyContours.contours[i].bounds);
+            
+            simplifier.simplify(bodyContours.getPoints(i), bodyContours.contours[i].count,
+                                renderVertexBudget, polylines[i], physicsVertexBudget, coarsePolylines[i]);
         }
+        Profiler::end(PROFILE_POLYLINES);
+        
+        //match bodies to last frame's and move their outlines into screen space, once per new contour
+        updateBodies();
+        contoursDoneMicros = ofGetElapsedTimeMicros();
+        
+        //kept for a few seconds in case this turns out to be a slow stretch
+        jankDetector.recordKinect(kinect.getRawDepthPixels().getData(), bodyContours);
         
 	}
 	
@@ -161,14 +253,59 @@ void ofApp::update() {
 #endif
     
     //update particle system
-    system.update();
+    jankDetector.recordFrame(system, flowWorker.hasResult() ? flowWorker.getResult().stats : FlowStats(), bodyContours.points.size());
+    inputRecorder.record(system);
+    {
+        ProfileScope scope(PROFILE_PARTICLES_UPDATE);
+        latency.beginSim();
+        system.update();
+        latency.endSim();
+    }
 
-    //send the polyline of the largest blob to Particle System class.
-    system.receivePoints(largestBlob);
+    //send the outline of every tracked body to Particle System class, each drives its own group of particles.
+    //bodies keep their slot while they stay tracked, so the groups stay bound to the same person.
+    //a slot nobody is in right now (below someone else's) lends its particles to a tracked body.
+    int slots = blobTracker.getNumSlots();
+    system.setNumBodies(slots);
+    for(int s = 0; s < slots; s++){
+        if(!blobTracker.isSlotTaken(s)) system.releaseBody(s);
+    }
+    for(int i = 0; i < blobTracker.tracks.size(); i++){
+        system.receiveBody(blobTracker.tracks[i].slot, blobTracker.tracks[i].outlineCoarse);
+    }
+    if(kinect.isFrameNew()) {
+        latency.handOff(LATENCY_BODY, frameCaptureMicros, contoursDoneMicros);
+    }
 
     //update optical flow calculations
     opticalFlowUpdate();
     
+    //predict where to look next frame from what was found in this one
+    if(kinect.isFrameNew()) {
+        roiTracker.update(foundBounds);
+    }
+    
+    //counter tracks for the trace export
+    traceRecorder.setCounter(TRACE_PARTICLES, system.particles.size());
+    traceRecorder.setCounter(TRACE_BLOBS, blobTracker.tracks.size());
+    traceRecorder.setCounter(TRACE_CONTOUR_VERTICES, bodyContours.points.size());
+    traceRecorder.update();
+    
+    //a few times a second, not every frame: the numbers for the venue monitoring
+    if(telemetry.isDue()){
+        TelemetryFrame t;
+        t.fps = ofGetFrameRate();
+        t.frame = ofGetFrameNum();
+        t.mode = mode;
+        t.particles = system.particles.size();
+        t.blobs = blobTracker.tracks.size();
+        t.contourVertices = bodyContours.points.size();
+        t.flow = flowWorker.hasResult() ? flowWorker.getResult().stats : FlowStats();
+        t.allocations = AllocationTracker::getFrameTotal().allocations;
+        t.allocatedBytes = AllocationTracker::getFrameTotal().bytes;
+        telemetry.publish(t);
+    }
+    
 }
 
 //--------------------------------------------------------------
@@ -191,8 +328,22 @@ void ofApp::draw() {
 		kinect.drawDepth(10, 10, 400, 300);
         kinect.draw(420, 10, 400, 300);
 		
-		grayImage.draw(10, 320, 400, 300);
-		contourFinder.draw(10, 320, 400, 300);
+		// the half size mask is plenty for a 400x300 preview and a quarter of the upload
+		const Mat & debugMask = pyramid.getMask(1);
+		debugMaskTexture.loadData(debugMask.data, debugMask.cols, debugMask.rows, GL_LUMINANCE);
+		debugMaskTexture.draw(10, 320, 400, 300);
+		float debugScaleX = 400. / kinect.width;
+		float debugScaleY = 300. / kinect.height;
+		bodyContours.draw(10, 320, 400, 300);
+        for(int i = 0; i < blobTracker.tracks.size(); i++){
+            const TrackedBlob & track = blobTracker.tracks[i];
+            ofDrawBitmapString("id " + ofToString(track.id), 10 + track.bounds.x * debugScaleX, 320 + track.bounds.y * debugScaleY);
+        }
+        ofPushStyle();
+        ofNoFill();
+        ofSetColor(255, 255, 0);
+        ofDrawRectangle(10 + contourRoi.x * debugScaleX, 320 + contourRoi.y * debugScaleY, contourRoi.width * debugScaleX, contourRoi.height * debugScaleY);
+        ofPopStyle();
 		
 #ifdef USE_TWO_KINECTS
 		kinect2.draw(420, 320, 400, 300);
@@ -213,9 +364,31 @@ void ofApp::draw() {
     }
     
 	reportStream << "press p to switch between images and point cloud, rotate the point cloud with the mouse" << endl
+	<< "using raw mm depth = " << bRawDepth << " (press r)" << endl
+	<< "background subtraction = " << depthSegmenter.useBackground << " (press B), learned = " << depthSegmenter.hasBackground()
+	<< (depthSegmenter.isLearning() ? " - learning..." : "") << " (press b to relearn with the space empty)" << endl
 	<< "using opencv threshold = " << bThreshWithOpenCV <<" (press spacebar)" << endl
-	<< "set near threshold " << nearThreshold << " (press: + -)" << endl
-	<< "set far threshold " << farThreshold << " (press: < >) num blobs found " << contourFinder.nBlobs
+	<< "optical flow: " << flowWorker.getResult().engineName << " " << ofToString(flowWorker.getResult().computeMillis, 2) << "ms (press f to switch)"
+	<< ", latency " << ofToString(flowWorker.getLatencyMillis(), 1) << "ms / " << ofToString(flowWorker.getFramesBehind(), 1) << " frames, dropped " << flowWorker.getDroppedFrames() << endl
+	<< "gesture: " << gestures.getLastName() << ", waves " << gestures.getCount(GestureEvent::WAVE_LEFT) << " left / "
+	<< gestures.getCount(GestureEvent::WAVE_RIGHT) << " right, " << system.waveCounter << "/" << system.wavesPerMode << " to the next mode" << endl
+	<< "profiler HUD = " << showProfiler << " (press h, H dumps csv), strict allocations = " << AllocationTracker::strict << " (press A), cpu counters = " << HardwareCounters::enabled << " (press K), t saves a trace of the last 10s, T of the next 10s"
+	<< (traceRecorder.isCapturing() ? " - capturing..." : "") << endl
+	<< "masked stats = " << flowWorker.useMask << " (press m), local flow = " << system.useFlowField << " (press l)"
+	<< ", recording = " << flowBenchmark.isRecording() << " (press R), press F to benchmark the last recording" << endl
+	<< "jank detector = " << jankDetector.enabled << " (press j), frames over " << jankDetector.budgetMillis << "ms = " << jankDetector.getSpikes() << " (J dumps the last few seconds)" << endl
+	<< "recording particle inputs = " << inputRecorder.isRecording() << " (press I), latency HUD = " << showLatency << " (press L): body "
+	<< ofToString(latency.getPercentile(LATENCY_BODY, 0.5), 1) << "ms, flow " << ofToString(latency.getPercentile(LATENCY_FLOW, 0.5), 1) << "ms" << endl;
+    
+    if(bRawDepth) {
+        reportStream << "set near threshold " << depthSegmenter.nearMM << "mm (press: + -)" << endl
+        << "set far threshold " << depthSegmenter.farMM << "mm (press: < >) num blobs found " << bodyContours.size() << ", tracked " << blobTracker.tracks.size();
+    } else {
+        reportStream << "set near threshold " << nearThreshold << " (press: + -)" << endl
+        << "set far threshold " << farThreshold << " (press: < >) num blobs found " << bodyContours.size() << ", tracked " << blobTracker.tracks.size();
+    }
+    
+    reportStream
 	<< ", fps: " << ofGetFrameRate() << endl
 	<< "press c to close the connection and o to open it again, connection is: " << kinect.isConnected() << endl;
 
@@ -229,41 +402,16 @@ void ofApp::draw() {
     }
 
     
-    //Need to find a polyline with a large perimeter.
-
-    for(int i = 0; i < polylines.size(); i++){
-
-        if(polylines[i].getPerimeter() > 300){
-            
-            //label that polyline as the largest blob!
-            largestBlob = polylines[i].getSmoothed(10);
-            largestBlob.setClosed(true);
-            
-            //Resample the whole line with a rough workaround to reposition the blob without ofTranslation issues between classes
-            //A bit hacky, but works well
-            vector<ofPoint> tempVert;
-            int xAxisOffset = 180;
-            int yAxisOffset = 50;
-
-            for(int i = 0; i < largestBlob.size(); i ++){
-            tempVert = largestBlob.getVertices();
-            tempVert[i].x += xAxisOffset;
-            tempVert[i].y += yAxisOffset;
-            largestBlob = tempVert;
-            }
-        }
-    }
-
-    
 //    ofScale(1.5, 1.5);
     
     
     // calculate ofPath to use for displaying a filled blob for the body
     // Incoming 'mode' changes different colour settings.
 
+    Profiler::begin(PROFILE_BODY_FILL);
     ofPushStyle();
     ofFill();
-    ofPath path;
+    path.clear();
     
     if(mode == 1){
         float lerpAmt = ofMap(avgX, -5, 5, 0., 1.);
@@ -291,14 +439,17 @@ void ofApp::draw() {
          path.setFillColor(blobColor);
      }
     
-    // transfer points from polyline to path
+    // transfer points from polyline to path, one sub path per tracked body
     
-    for( int i = 0; i < largestBlob.getVertices().size(); i++) {
-        if(i == 0) {
-            path.newSubPath();
-            path.moveTo(largestBlob.getVertices()[i] );
-        } else {
-            path.lineTo( largestBlob.getVertices()[i] );
+    for( int b = 0; b < blobTracker.tracks.size(); b++) {
+        const vector<ofPoint> & outline = blobTracker.tracks[b].outline.getVertices();
+        for( int i = 0; i < outline.size(); i++) {
+            if(i == 0) {
+                path.newSubPath();
+                path.moveTo( outline[i] );
+            } else {
+                path.lineTo( outline[i] );
+            }
         }
     }
     
@@ -307,18 +458,81 @@ void ofApp::draw() {
     path.simplify();
     path.draw();
     ofPopStyle();
+    Profiler::end(PROFILE_BODY_FILL);
 
     //display particle system
-    system.draw();
+    {
+        ProfileScope scope(PROFILE_PARTICLES_DRAW);
+        system.draw();
+    }
     
     //draw optical flow and display vectors (only in debug)
     opticalFlowDraw();
+    
+    //per stage timings (press h, H saves them to csv)
+    float hudBottom = 20;
+    if(showProfiler){
+        Profiler::summarise();
+        hudBottom += Profiler::drawHud(ofGetWidth() - 490, 20) + 20;
+    }
+    
+    //capture to swap latency histogram and breakdown (press L)
+    if(showLatency){
+        latency.draw(ofGetWidth() - 490, hudBottom);
+    }
+    
+    latency.endRender();
+    Profiler::begin(PROFILE_SWAP);
 }
 
 
 
+//--------------------------------------------------------------
+void ofApp::updateBodies() {
+    
+    //only outlines big enough to be a person are tracked, like before
+    trackCandidates.clear();
+    for(int i = 0; i < polylines.size(); i++){
+        if(polylines[i].getPerimeter() >= 300) trackCandidates.push_back(i);
+    }
+    
+    blobTracker.update(bodyContours.contours, trackCandidates);
+    
+    //contours arrive at the kinect's rate, not ours
+    float now = ofGetElapsedTimef();
+    float contourDt = now - lastContourTime;
+    lastContourTime = now;
+    
+    //Reposition each body seen this frame into screen space in one pass (rough offset to line the body
+    //up with the particles without ofTranslate issues between classes).
+    //bodies missing for a frame or two keep their last outline. the outlines live in the tracks and
+    //are written in place, so once warmed up this doesn't allocate.
+    for(int t = 0; t < blobTracker.tracks.size(); t++){
+        TrackedBlob & track = blobTracker.tracks[t];
+        if(track.contour < 0) continue;
+        
+        simplifier.smooth(polylines[track.contour], 10, track.outline);
+        for(int i = 0; i < track.outline.size(); i++){
+            track.outline[i] = track.outline[i] * bodyScale + bodyOffset;
+        }
+        
+        //the particles get the coarse outline, resampled evenly, lined up with last frame's and filtered
+        //over time so particles chasing it don't shake. moved the same way.
+        track.filter.numVertices = physicsVertexBudget;
+        track.filter.filter(coarsePolylines[track.contour], contourDt, track.outlineCoarse);
+        for(int i = 0; i < track.outlineCoarse.size(); i++){
+            track.outlineCoarse[i] = track.outlineCoarse[i] * bodyScale + bodyOffset;
+        }
+    }
+}
+
 //--------------------------------------------------------------
 void ofApp::exit() {
+    ofRemoveListener(gestures.gestureEvent, &system, &ParticleSystem::onGesture);
+    flowWorker.stop();
+    telemetry.stop();
+    inputRecorder.stop();
+    writer.stop();
 	kinect.setCameraTiltAngle(0); // zero the tilt on exit
 	kinect.close();
 	
@@ -330,56 +544,61 @@ void ofApp::exit() {
 //--------------------------------------------------------------
 void ofApp::opticalFlowDraw(){
     
-    //calculate optical flow and find average optical flow values for X and Y.
+    //visualise the optical flow (debug only) - the numbers themselves are worked out in update
     
-    sumX = 0;
-    sumY =0;
-    avgX = 0;
-    avgY = 0;
-    numOfEntries = 0;
-    if (calculatedFlow)
-    {
-        
-        int w = gray1.width;
-        int h = gray1.height;
-        
-        //1. Input images + optical flow
-        ofPushMatrix();
-        ofScale( 8, 8 );
-        
-        
-        //Optical flow
-        float *flowXPixels = flowX.getPixelsAsFloats();
-        float *flowYPixels = flowY.getPixelsAsFloats();
-        ofSetColor( 0, 0, 255 );
-        for (int y = h/2 - 25; y < h/2 + 25; y+=5) {
-            for (int x = w/2 - 25; x < w/2 + 25; x+=5) {
-                
-                
-                float fx = flowXPixels[ x + w * y ];
-                float fy = flowYPixels[ x + w * y ];
-                //Draw only long vectors
-                if ( fabs( fx ) + fabs( fy ) > 1 ) {
-                    if(debug){
-                        ofDrawRectangle( x-0.5, y-0.5, 1, 1 );
-                        ofDrawLine( x, y, x + fx, y + fy );
-                    }
-                    sumX += fx;
-                    sumY += fy;
-                    
-                    numOfEntries ++;
-                    
-                }
+    if (!debug || !flowWorker.hasResult()) return;
+    
+    const FlowResult & result = flowWorker.getResult();
+    const Mat & flow = result.flow;
+    ofRectangle flowRoi = result.roi;
+    const FlowStats & flowStats = result.stats;
+    
+    //1. Input images + optical flow
+    ofPushMatrix();
+    ofScale( 8, 8 );
+    
+    //Draw only long vectors, every 5th pixel of the region flow was computed in
+    ofSetColor( 0, 0, 255 );
+    for (int y = flowRoi.y; y < flowRoi.y + flowRoi.height; y+=5) {
+        //x and y are interleaved in the flow field
+        const float * flowRow = flow.ptr<float>( y );
+        for (int x = flowRoi.x; x < flowRoi.x + flowRoi.width; x+=5) {
+            float fx = flowRow[ x * 2 ];
+            float fy = flowRow[ x * 2 + 1 ];
+            if ( fabs( fx ) + fabs( fy ) > 1 ) {
+                ofDrawRectangle( x-0.5, y-0.5, 1, 1 );
+                ofDrawLine( x, y, x + fx, y + fy );
             }
         }
-        ofPopMatrix();
     }
+    ofPopMatrix();
+    
+    //2. magnitude histogram, mean (white) and dominant direction (yellow)
+    ofPushStyle();
+    ofPushMatrix();
+    ofTranslate( ofGetWidth() - 220, ofGetHeight() - 140 );
     
-    // calculate averages
-    if(numOfEntries > 0){
-        avgX = sumX / numOfEntries;
-        avgY = sumY / numOfEntries;
+    float maxCount = 1;
+    for (int i = 0; i < FlowStats::numMagnitudeBins; i++) {
+        maxCount = max( maxCount, flowStats.magnitudeHistogram[i] );
     }
+    ofSetColor( 0, 0, 255 );
+    for (int i = 0; i < FlowStats::numMagnitudeBins; i++) {
+        float barHeight = 100 * flowStats.magnitudeHistogram[i] / maxCount;
+        ofDrawRectangle( i * 6, 100 - barHeight, 5, barHeight );
+    }
+    
+    ofPoint centre( 160, 50 );
+    ofSetColor( 255 );
+    ofDrawLine( centre.x, centre.y, centre.x + flowStats.meanX * 8, centre.y + flowStats.meanY * 8 );
+    ofSetColor( 255, 255, 0 );
+    float length = 40 * flowStats.dominantStrength;
+    ofDrawLine( centre.x, centre.y, centre.x + cos( flowStats.dominantDirection ) * length, centre.y + sin( flowStats.dominantDirection ) * length );
+    
+    ofDrawBitmapString( "mean " + ofToString( flowStats.meanX, 1 ) + ", " + ofToString( flowStats.meanY, 1 )
+                       + "  median " + ofToString( flowStats.medianX, 1 ) + ", " + ofToString( flowStats.medianY, 1 ), 0, 120 );
+    ofPopMatrix();
+    ofPopStyle();
 
 }
 
@@ -391,37 +610,39 @@ void ofApp::opticalFlowUpdate(){
     //Image manipulation to find the optical flow
     
     if(kinect.isFrameNew()) {
-        if ( gray1.bAllocated ) {
-            gray2 = gray1;
-            calculatedFlow = true;
+        
+        //only compute flow inside the body's region (the kinect colour image isn't mirrored, the mask is).
+        ofRectangle flowRoi = roiTracker.getScaledRoi(FramePyramid::getScale(flowLevel), true);
+        
+        //the sparse engine only tracks the outlines of the bodies seen this frame
+        flowTrackPoints.clear();
+        for(int t = 0; t < blobTracker.tracks.size(); t++){
+            int contour = blobTracker.tracks[t].contour;
+            if(contour < 0) continue;
+            const vector<ofPoint> & outline = coarsePolylines[contour].getVertices();
+            flowTrackPoints.insert(flowTrackPoints.end(), outline.begin(), outline.end());
         }
         
-        //Convert to ofxCv images
-        ofPixels & pixels = kinect.getPixels();
-        currentColor.setFromPixels( pixels );
+        //the worker copies what it needs and works the flow out on its own thread
+        flowWorker.publish(pyramid.getLuminance(flowLevel), flowRoi, flowTrackPoints, pyramid.getMask(flowLevel), true, frameCaptureMicros);
+    }
+    
+    //pick up the newest finished field - computed from an earlier frame, usually the last one
+    if(flowWorker.fetch()) {
+        const FlowResult & result = flowWorker.getResult();
+        flowBenchmark.recordFrame(result.gray, result.trackPoints);
         
-        float decimate = 0.25;              //Decimate images to 25% (makes calculations faster + works like a blurr too)
-        ofxCvColorImage imageDecimated1;
-        imageDecimated1.allocate( currentColor.width * decimate, currentColor.height * decimate );
-        imageDecimated1.scaleIntoMe( currentColor, CV_INTER_AREA );             //High-quality resize
-        gray1 = imageDecimated1;
+        //mean of the moving flow vectors over the whole region
+        avgX = result.stats.meanX;
+        avgY = result.stats.meanY;
         
-        if ( gray2.bAllocated ) {
-            Mat img1( gray1.getCvImage() );  //Create OpenCV images
-            Mat img2( gray2.getCvImage() );
-            Mat flow;                        //Image for flow
-            //Computing optical flow (visit https://goo.gl/jm1Vfr for explanation of parameters)
-            calcOpticalFlowFarneback( img1, img2, flow, 0.7, 3, 11, 5, 5, 1.1, 0 );
-            //Split flow into separate images
-            vector<Mat> flowPlanes;
-            split( flow, flowPlanes );
-            //Copy float planes to ofxCv images flowX and flowY
-            //we call this to convert back from native openCV to ofxOpenCV data types
-            IplImage iplX( flowPlanes[0] );
-            flowX = &iplX;
-            IplImage iplY( flowPlanes[1] );
-            flowY = &iplY;
-        }
+        //one step of the gesture detector per field
+        gestures.update(result.stats, ofGetElapsedTimef());
+        
+        //local field, laid over the same screen area as the body outlines
+        ofRectangle screenRect(bodyOffset.x, bodyOffset.y, kinect.width * bodyScale, kinect.height * bodyScale);
+        system.receiveFlowField(result.grid, screenRect);
+        latency.handOff(LATENCY_FLOW, result.captureMicros, result.finishedMicros);
     }
 
     // send optical flow values to particle system
@@ -445,27 +666,118 @@ void ofApp::keyPressed (int key) {
 		case ' ':
 			bThreshWithOpenCV = !bThreshWithOpenCV;
 			break;
+            
+        case 'r':
+            bRawDepth = !bRawDepth;
+            break;
+            
+        case 'b':
+            depthSegmenter.learnBackground(90);
+            break;
+            
+        case 'f':
+            flowWorker.nextEngine();
+            break;
+            
+        case 'm':
+            flowWorker.useMask = !flowWorker.useMask;
+            break;
+            
+        case 'l':
+            system.useFlowField = !system.useFlowField;
+            break;
+            
+        case 'h':
+            showProfiler = !showProfiler;
+            break;
+            
+        case 'H':
+            Profiler::dumpCsv();
+            break;
+            
+        case 'K':
+            HardwareCounters::enabled = !HardwareCounters::enabled;
+            break;
+            
+        case 'A':
+            AllocationTracker::strict = !AllocationTracker::strict;
+            break;
+            
+        case 't':
+            traceRecorder.saveLast(10);
+            break;
+            
+        case 'T':
+            traceRecorder.trigger(10);
+            break;
+            
+        case 'R':
+            if(flowBenchmark.isRecording()) flowBenchmark.stopRecording();
+            else flowBenchmark.startRecording();
+            break;
+            
+        case 'L':
+            showLatency = !showLatency;
+            break;
+            
+        case 'j':
+            jankDetector.enabled = !jankDetector.enabled;
+            break;
+            
+        case 'J':
+            jankDetector.dump("requested");
+            break;
+            
+        case 'I':
+            if(inputRecorder.isRecording()) inputRecorder.stop();
+            else inputRecorder.start();
+            break;
+            
+        case 'F':
+            flowBenchmark.stopRecording();
+            flowBenchmark.run();
+            break;
+            
+        case 'B':
+            depthSegmenter.useBackground = !depthSegmenter.useBackground;
+            break;
 			
-			
+		// in raw mode the planes move 10mm per press, in the same direction as the 8 bit keys
 		case '>':
 		case '.':
+            if(bRawDepth) {
+                depthSegmenter.setRange(depthSegmenter.nearMM, depthSegmenter.farMM - 10);
+                break;
+            }
 			farThreshold ++;
 			if (farThreshold > 255) farThreshold = 255;
 			break;
 			
 		case '<':
 		case ',':
+            if(bRawDepth) {
+                depthSegmenter.setRange(depthSegmenter.nearMM, depthSegmenter.farMM + 10);
+                break;
+            }
 			farThreshold --;
 			if (farThreshold < 0) farThreshold = 0;
 			break;
 			
 		case '+':
 		case '=':
+            if(bRawDepth) {
+                depthSegmenter.setRange(depthSegmenter.nearMM - 10, depthSegmenter.farMM);
+                break;
+            }
 			nearThreshold ++;
 			if (nearThreshold > 255) nearThreshold = 255;
 			break;
 			
 		case '-':
+            if(bRawDepth) {
+                depthSegmenter.setRange(depthSegmenter.nearMM + 10, depthSegmenter.farMM);
+                break;
+            }
 			nearThreshold --;
 			if (nearThreshold < 0) nearThreshold = 0;
 			break;
@@ -7,6 +7,22 @@
 #include "Particle.hpp"
 #include "Attractor.hpp"
 #include "ParameterSmoother.hpp"
+#include "DepthSegmenter.hpp"
+#include "RoiTracker.hpp"
+#include "BodyContourFinder.hpp"
+#include "ContourSimplifier.hpp"
+#include "BlobTracker.hpp"
+#include "FlowWorker.hpp"
+#include "FramePyramid.hpp"
+#include "GestureDetector.hpp"
+#include "Profiler.hpp"
+#include "TraceRecorder.hpp"
+#include "FlowBenchmark.hpp"
+#include "InputRecording.hpp"
+#include "LatencyTracker.hpp"
+#include "JankDetector.hpp"
+#include "BackgroundWriter.hpp"
+#include "TelemetryPublisher.hpp"
 
 
 using namespace cv;
@@ -48,6 +64,7 @@ public:
 	void windowResized(int w, int h);
     void opticalFlowUpdate();
     void opticalFlowDraw();
+    void updateBodies();
     
     ParticleSystem system;
     ofxKinect kinect;
@@ -61,26 +78,52 @@ public:
 	ofxCvGrayscaleImage grayImage; // grayscale depth image
 	ofxCvGrayscaleImage grayThreshNear; // the near thresholded image
 	ofxCvGrayscaleImage grayThreshFar; // the far thresholded image
-	ofxCvContourFinder contourFinder;
+	BodyContourFinder bodyContours;
+    DepthSegmenter depthSegmenter; // millimetre band-pass on the raw 16 bit depth
+    RoiTracker roiTracker;         // predicted body region, limits contours / cleanup / flow
+    ofRectangle contourRoi;        // region contours were found in this frame (mask coords)
+    FramePyramid pyramid;          // full, 1/2, 1/4 mask + luminance, built once per new frame
+    int contourLevel;              // pyramid level contours are found on (1 trades outline detail for speed)
+    int flowLevel;                 // pyramid level the optical flow runs on
+    ofTexture debugMaskTexture;
+    vector <ofRectangle> foundBounds;
     
-    vector <ofxCvBlob> blobs;
-    vector <ofPolyline> polylines;
-    ofPolyline largestBlob;
-    ofPath path;
+    ContourSimplifier simplifier;
+    int renderVertexBudget;  // max vertices of the drawn body outline
+    int physicsVertexBudget; // max vertices of the outline the particles follow
+    
+    vector <ofPolyline> polylines;       // fine level of detail, for drawing
+    vector <ofPolyline> coarsePolylines; // coarse level of detail, for the particle system
+    BlobTracker blobTracker;             // persistent ids for every body, each drives its own particle group
+    vector <int> trackCandidates;
+    ofPoint bodyOffset;      // mask -> screen transform for the body outlines
+    float bodyScale;
+    float lastContourTime;
+    ofPath path;             // body fill, a member so its storage is reused
 	
 	bool bThreshWithOpenCV;
+    bool bRawDepth; // segment from raw millimetres instead of the 8 bit depth image
 	int nearThreshold;
 	int farThreshold;
 	int angle;
-    bool calculatedFlow;
     
-    ofxCvColorImage currentColor;        //First and second original images
-    ofxCvGrayscaleImage gray1, gray2;    //Decimated grayscaled images
-    ofxCvFloatImage flowX, flowY;        //Resulted optical flow in x and y axes
+    FlowWorker flowWorker;               //Decimated optical flow on its own thread, one frame behind
+    FlowBenchmark flowBenchmark;         //Session recording + offline comparison of the flow engines
+    vector <ofPoint> flowTrackPoints;
+    GestureDetector gestures;            //Waves / push / stillness from the flow statistics, drives the mode changes
     
-    float sumX, sumY, avgX, avgY;
-    int numOfEntries;
+    float avgX, avgY;
     bool debug;
+    bool showProfiler;
+    TraceRecorder traceRecorder;         //Chrome trace / Perfetto export of the stage timings
+    LatencyTracker latency;              //Capture to buffer swap, per input and per stage
+    uint64_t frameCaptureMicros;         //When the current kinect frame was picked up, travels with the outlines and flow
+    uint64_t contoursDoneMicros;
+    bool showLatency;
+    JankDetector jankDetector;           //Dumps the last few seconds of inputs and timings when a frame runs over budget
+    TelemetryPublisher telemetry;        //OSC bundles for the venue monitoring, a few a second from its own thread
+    InputRecorder inputRecorder;         //Per frame particle system inputs, replayed by the determinism harness in bench/
+    BackgroundWriter writer;             //Writes traces and jank dumps on one thread; after them so it finishes (and goes) first
     int mode;
     ofColor blobFrom;
     ofColor blobTo;